@@ -0,0 +1,70 @@
+#include "alloc.h"
+#include "global.h"
+#include <sys/mman.h>
+
+int largePages = TRUE;
+
+
+static size_t mappedBytes(size_t bytes){
+    // Tables of a megabyte and more are rounded up to whole 2MB pages.
+    if (largePages && bytes >= LARGE_PAGE_BYTES / 2)
+        return (bytes + LARGE_PAGE_BYTES - 1) & ~((size_t) LARGE_PAGE_BYTES - 1);
+    return bytes;
+}
+
+
+void *allocTable(size_t bytes, int *pages, size_t *mapped){
+    size_t size = mappedBytes(bytes);
+    char *table = MAP_FAILED, *aligned;
+    int backing = PAGES_NORMAL;
+
+#ifdef MAP_HUGETLB
+    if (largePages && size % LARGE_PAGE_BYTES == 0) {
+        table = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        backing = PAGES_HUGETLB;
+    }
+#endif
+    if (table != MAP_FAILED) {
+        if (pages != NULL)
+            *pages = backing;
+        *mapped = size;
+        return table;
+    }
+
+    backing = PAGES_NORMAL;
+    if (!largePages || size % LARGE_PAGE_BYTES != 0) {
+        table = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        aligned = table;
+    } else {
+        // Transparent huge pages need 2MB aligned memory: map one page more and trim both ends.
+        table = mmap(NULL, size + LARGE_PAGE_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (table != MAP_FAILED) {
+            aligned = (char *) (((size_t) table + LARGE_PAGE_BYTES - 1) & ~((size_t) LARGE_PAGE_BYTES - 1));
+            if (aligned > table)
+                munmap(table, aligned - table);
+            munmap(aligned + size, table + LARGE_PAGE_BYTES - aligned);
+#ifdef MADV_HUGEPAGE
+            if (madvise(aligned, size, MADV_HUGEPAGE) == 0)
+                backing = PAGES_TRANSPARENT;
+#endif
+        }
+    }
+    if (table == MAP_FAILED)
+        return NULL;
+
+    if (pages != NULL)
+        *pages = backing;
+    *mapped = size;
+    return aligned;
+}
+
+
+void freeTable(void *table, size_t mapped){
+    if (table != NULL)
+        munmap(table, mapped);
+}
+
+
+const char *pagesName(int pages){
+    return pages == PAGES_HUGETLB ? "hugetlb" : (pages == PAGES_TRANSPARENT ? "transparent" : "normal");
+}
@@ -0,0 +1,31 @@
+#ifndef ALLOC_H
+#define ALLOC_H
+
+#include <stddef.h>
+
+/*
+ * Memory for the large hash tables (transposition table, evaluation cache).
+ * Probes are random over the whole table, so with 4KB pages nearly every one
+ * is also a TLB miss. Tables are backed by 2MB pages when the system has them:
+ * reserved huge pages (MAP_HUGETLB) first, else transparent huge pages asked
+ * for with madvise(), else normal pages. Memory is zeroed.
+ */
+#define LARGE_PAGE_BYTES (2 << 20)
+
+#define PAGES_NORMAL 0
+#define PAGES_TRANSPARENT 1		// madvise( MADV_HUGEPAGE ), the kernel may still use 4KB pages
+#define PAGES_HUGETLB 2
+
+extern int largePages;			// TRUE: try 2MB pages (default)
+
+void *allocTable(size_t bytes, int *pages, size_t *mapped);
+// zeroed memory for a table, *pages (if not NULL) tells how it is backed, *mapped how many bytes were mapped
+// (bytes rounded up to 2MB pages or not, depending on largePages at the time), NULL on failure
+
+void freeTable(void *table, size_t mapped);
+// releases memory from allocTable() (mapped as it returned, largePages may have changed since)
+
+const char *pagesName(int pages);
+// "hugetlb", "transparent" or "normal"
+
+#endif
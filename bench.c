@@ -0,0 +1,641 @@
+#include "global.h"
+#include "board.h"
+#include "eval.h"
+#include "minimax.h"
+#include "symmetry.h"
+#include "pack.h"
+#include "tt.h"
+#include "alloc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Search benchmark: fixed-depth searches of a reproducible set of positions.
+ *
+ * Positions are taken from random games (same seed -> same positions) when the
+ * number of empty tiles reaches a target inside [minEmpties, maxEmpties]. By
+ * default the range covers the move to the disc-count endgame (ENDGAME_EMPTIES).
+ * Results are reported in total and per band of empty tiles.
+ *
+ * With -k it checks the bitboard feature kernels instead: the scalar and the
+ * AVX2 kernel must give the same counts as each other and as the counts kept
+ * up to date by doMove(), and both are timed. With a network (-e nnue -w file)
+ * the accumulators kept by doMove() are checked against nnueRefresh() too,
+ * and the hashes kept by doMove() against syncPosition(). Every position is
+ * also checked against its 11 symmetric images (canonical hash, legal moves,
+ * classic evaluation, and back to itself with the inverse symmetry).
+ * Last, the batched child scores of evaluateChildren() are compared with
+ * evaluate() on each child and both ways of scoring the children are timed.
+ *
+ * With -m it measures how far searches of 1..PRUNE_DEPTH plies move away from
+ * the static score (to pick the forward pruning margins), and with -a it
+ * searches every position with and without forward pruning and compares them.
+ */
+
+#define BAND_WIDTH 8
+#define MAX_BANDS ( HEX_CELLS / BAND_WIDTH + 1 )
+
+/**********************************************************/
+typedef struct
+{
+	int positions;
+	double seconds;
+	SearchStats stats;
+} Band;
+
+/**********************************************************/
+unsigned int benchSeed = 1;
+
+/**********************************************************/
+unsigned int nextRandom( void )
+{
+	benchSeed = benchSeed * 1103515245 + 12345;
+	return ( benchSeed >> 16 ) & 0x7fff;
+}
+
+/**********************************************************/
+int randomPosition( Position * pos, int targetEmpties )
+{
+	/* plays random moves until targetEmpties are left, FALSE if the game ends first */
+	Move moveList[ HEX_CELLS ], m;
+	BitBoard legal;
+	int n, i, j;
+
+	initPosition( pos );
+
+	while( HEX_CELLS - pos->score[ WHITE ] - pos->score[ BLACK ] > targetEmpties )
+	{
+		legal = legalMoves( pos, pos->turn );
+		n = 0;
+		for( i = 0; i < ARRAY_BOARD_SIZE; i++ )
+			for( j = 0; j < ARRAY_BOARD_SIZE; j++ )
+				if( bbTest( legal, BB_INDEX( i, j ) ) )
+				{
+					moveList[ n ].tile[ 0 ] = i;
+					moveList[ n ].tile[ 1 ] = j;
+					moveList[ n ].color = pos->turn;
+					n++;
+				}
+
+		if( n == 0 )
+		{
+			if( !canMove( pos, getOtherSide( pos->turn ) ) )
+				return FALSE;
+			m.tile[ 0 ] = NULL_MOVE;
+			m.color = pos->turn;
+			doMove( pos, &m );
+			continue;
+		}
+
+		doMove( pos, &moveList[ nextRandom() % n ] );
+	}
+
+	return canMove( pos, pos->turn );
+}
+
+/**********************************************************/
+void addStats( SearchStats * to, SearchStats * from )
+{
+	to->nodes += from->nodes;
+	to->leaves += from->leaves;
+	to->cutoffs += from->cutoffs;
+	to->firstCutoffs += from->firstCutoffs;
+	to->stableCutoffs += from->stableCutoffs;
+	to->futilityPrunes += from->futilityPrunes;
+	to->razorSearches += from->razorSearches;
+	to->razorPrunes += from->razorPrunes;
+}
+
+/**********************************************************/
+void printBand( char * name, Band * b )
+{
+	long long total = b->stats.nodes + b->stats.leaves;
+
+	printf( "%-10s %5d %12lld %9.3f %10.0f %10lld %7.1f%% %8lld\n", name, b->positions, total, b->seconds,
+		b->seconds > 0 ? total / b->seconds : 0.0, b->stats.cutoffs,
+		b->stats.cutoffs ? 100.0 * b->stats.firstCutoffs / b->stats.cutoffs : 0.0, b->stats.stableCutoffs );
+}
+
+/**********************************************************/
+double seconds( struct timespec * t0, struct timespec * t1 )
+{
+	return ( t1->tv_sec - t0->tv_sec ) + ( t1->tv_nsec - t0->tv_nsec ) / 1e9;
+}
+
+/**********************************************************/
+int childMoves( Position * pos, Move moves[] )
+{
+	BitBoard legal = legalMoves( pos, pos->turn );
+	int n = 0, index;
+
+	for( index = bbFirst( legal ); index >= 0; bbClear( &legal, index ), index = bbFirst( legal ) )
+	{
+		moves[ n ].tile[ 0 ] = BB_ROW( index );
+		moves[ n ].tile[ 1 ] = BB_COL( index );
+		moves[ n ].color = pos->turn;
+		n++;
+	}
+
+	return n;
+}
+
+/**********************************************************/
+int evaluateOneByOne( Position * pos, Move moves[], int n, int scores[] )
+{
+	Position child;
+	int m;
+
+	for( m = 0; m < n; m++ )
+	{
+		memcpy( &child, pos, sizeof( Position ) );
+		doMove( &child, &moves[ m ] );
+		scores[ m ] = evaluate( &child );
+	}
+
+	return n;
+}
+
+/**********************************************************/
+int checkBatch( Position * pos, int positions )
+{
+	Move moves[ HEX_CELLS ];
+	int batch[ HEX_CELLS ], single[ HEX_CELLS ];
+	long long children = 0, differ = 0, error = 0;
+	struct timespec t0, t1;
+	int k, m, n, r;
+
+	for( k = 0; k < positions; k++ )
+	{
+		n = childMoves( &pos[ k ], moves );
+		evaluateChildren( &pos[ k ], moves, n, batch );
+		evaluateOneByOne( &pos[ k ], moves, n, single );
+		for( m = 0; m < n; m++ )
+			if( batch[ m ] != single[ m ] )
+			{
+				differ++;
+				error += abs( batch[ m ] - single[ m ] );
+			}
+		children += n;
+	}
+
+	printf( "%lld children, %lld batch scores differ from evaluate() (mean difference %.1f)\n",
+		children, differ, differ ? ( double ) error / differ : 0.0 );
+
+	for( r = 0; r < 2; r++ )
+	{
+		clock_gettime( CLOCK_MONOTONIC, &t0 );
+		for( k = 0; k < positions; k++ )
+		{
+			n = childMoves( &pos[ k ], moves );
+			if( r == 0 )
+				evaluateOneByOne( &pos[ k ], moves, n, single );
+			else
+				evaluateChildren( &pos[ k ], moves, n, batch );
+		}
+		clock_gettime( CLOCK_MONOTONIC, &t1 );
+		printf( "%-7s %8.1f ns/child\n", r == 0 ? "single" : "batch", seconds( &t0, &t1 ) * 1e9 / children );
+	}
+
+	/* exact for every evaluation but the classic one */
+	return evaluator != EVAL_CLASSIC && differ > 0;
+}
+
+/**********************************************************/
+int checkSymmetry( Position * pos )
+{
+	Position image, back;
+	uint64_t canonical = canonicalHash( pos, NULL );
+	int s, errors = 0;
+
+	for( s = 0; s < SYMMETRIES; s++ )
+	{
+		symTransformPosition( pos, &image, s );
+		symTransformPosition( &image, &back, symInverse[ s ] );
+
+		if( canonicalHash( &image, NULL ) != canonical
+			|| !bbEqual( symTransformBits( legalMoves( pos, pos->turn ), s ), legalMoves( &image, image.turn ) )
+			|| ( evaluator == EVAL_CLASSIC && evaluate( &image ) != evaluate( pos ) )
+			|| memcmp( back.board, pos->board, sizeof( pos->board ) ) != 0 || back.hash != pos->hash )
+		{
+			printf( "ERROR: symmetry %d does not hold\n", s );
+			errors++;
+		}
+	}
+
+	return errors;
+}
+
+/**********************************************************/
+int checkKernels( int positions, int minEmpties, int maxEmpties )
+{
+	Position * pos;
+	BBFeatures scalar, avx2;
+	short acc[ NNUE_HIDDEN ];
+	Position synced;
+	unsigned char packed[ PACKED_POSITION_BYTES ];
+	struct timespec t0, t1;
+	int k, c, r, errors = 0, sum = 0;
+
+	if( ( pos = malloc( sizeof( Position ) * positions ) ) == NULL )
+	{
+		printf( "ERROR: Out of memory\n" );
+		return 1;
+	}
+
+	for( k = 0; k < positions; k++ )
+	{
+		while( !randomPosition( &pos[ k ], maxEmpties - k % ( maxEmpties - minEmpties + 1 ) ) )
+			;
+
+		bbFeaturesScalar( pos[ k ].pieces, pos[ k ].illegal, &scalar );
+		if( bbHasAVX2 )
+			bbFeaturesAVX2( pos[ k ].pieces, pos[ k ].illegal, &avx2 );
+		else
+			avx2 = scalar;
+
+		for( c = 0; c < 2; c++ )
+			if( memcmp( &scalar, &avx2, sizeof( scalar ) ) != 0 || scalar.discs[ c ] != pos[ k ].score[ c ]
+				|| scalar.frontier[ c ] != pos[ k ].frontier[ c ] || scalar.border[ c ] != pos[ k ].border[ c ] )
+			{
+				printf( "ERROR: kernels disagree on position %d (color %d)\n", k, c );
+				errors++;
+				break;
+			}
+
+		errors += checkSymmetry( &pos[ k ] );
+
+		memcpy( &synced, &pos[ k ], sizeof( Position ) );
+		syncPosition( &synced );
+		if( synced.hash != pos[ k ].hash )
+		{
+			printf( "ERROR: hash differs on position %d\n", k );
+			errors++;
+		}
+
+		packPosition( &pos[ k ], packed );
+		unpackPosition( packed, &synced );
+		if( memcmp( synced.board, pos[ k ].board, sizeof( synced.board ) ) != 0 || synced.turn != pos[ k ].turn
+			|| synced.hash != pos[ k ].hash )
+		{
+			printf( "ERROR: packing does not round-trip on position %d\n", k );
+			errors++;
+		}
+
+		if( nnueEnabled )
+		{
+			nnueRefresh( pos[ k ].board, acc );
+			if( memcmp( acc, pos[ k ].nnueAcc, sizeof( acc ) ) != 0 )
+			{
+				printf( "ERROR: network accumulator differs on position %d\n", k );
+				errors++;
+			}
+		}
+	}
+
+	printf( "%d positions, AVX2 kernel %s, %d mismatches\n", positions, bbHasAVX2 ? "checked" : "not available", errors );
+
+	for( r = 0; r < 2; r++ )
+	{
+		if( r == 1 && !bbHasAVX2 )
+			break;
+		clock_gettime( CLOCK_MONOTONIC, &t0 );
+		for( c = 0; c < 100; c++ )
+			for( k = 0; k < positions; k++ )
+			{
+				if( r == 0 )
+					bbFeaturesScalar( pos[ k ].pieces, pos[ k ].illegal, &scalar );
+				else
+					bbFeaturesAVX2( pos[ k ].pieces, pos[ k ].illegal, &scalar );
+				sum += scalar.potMobility[ WHITE ];
+			}
+		clock_gettime( CLOCK_MONOTONIC, &t1 );
+		printf( "%-7s %8.1f ns/position\n", r == 0 ? "scalar" : "avx2", seconds( &t0, &t1 ) * 1e9 / ( 100.0 * positions ) );
+	}
+
+	clock_gettime( CLOCK_MONOTONIC, &t0 );
+	for( c = 0; c < 100; c++ )
+		for( k = 0; k < positions; k++ )
+		{
+			packPosition( &pos[ k ], packed );
+			sum += packed[ k % PACKED_POSITION_BYTES ] & 1;
+		}
+	clock_gettime( CLOCK_MONOTONIC, &t1 );
+	printf( "%-7s %8.1f ns/position (%d bytes)\n", "pack", seconds( &t0, &t1 ) * 1e9 / ( 100.0 * positions ), PACKED_POSITION_BYTES );
+
+	clock_gettime( CLOCK_MONOTONIC, &t0 );
+	for( c = 0; c < 100; c++ )
+		for( k = 0; k < positions; k++ )
+		{
+			unpackPosition( packed, &synced );	//includes syncPosition()
+			sum += synced.score[ WHITE ] & 1;
+		}
+	clock_gettime( CLOCK_MONOTONIC, &t1 );
+	printf( "%-7s %8.1f ns/position\n", "unpack", seconds( &t0, &t1 ) * 1e9 / ( 100.0 * positions ) );
+
+	if( nnueEnabled )
+	{
+		clock_gettime( CLOCK_MONOTONIC, &t0 );
+		for( c = 0; c < 100; c++ )
+			for( k = 0; k < positions; k++ )
+				sum += nnueEvaluate( pos[ k ].nnueAcc ) & 1;
+		clock_gettime( CLOCK_MONOTONIC, &t1 );
+		printf( "%-7s %8.1f ns/position\n", "nnue", seconds( &t0, &t1 ) * 1e9 / ( 100.0 * positions ) );
+	}
+
+	errors += checkBatch( pos, positions );
+
+	free( pos );
+	return ( errors || sum < 0 ) ? 1 : 0;
+}
+
+/**********************************************************/
+int cmpInt( const void * a, const void * b )
+{
+	return *( int * ) a - *( int * ) b;
+}
+
+/**********************************************************/
+void measureMargins( Position * pos, int positions )
+{
+	int * spread = malloc( sizeof( int ) * positions );
+	int plies, k, score;
+	double mean;
+	Move best;
+
+	forwardPruning = FALSE;
+	printf( "distance between a search and the static score (%d positions)\n", positions );
+	printf( "%-6s %8s %8s %8s %8s\n", "plies", "mean", "90%", "95%", "99%" );
+
+	for( plies = 1; plies <= PRUNE_DEPTH; plies++ )
+	{
+		mean = 0;
+		for( k = 0; k < positions; k++ )
+		{
+			score = rootSearch( &pos[ k ], pos[ k ].turn, TRUE, plies - 1, &best );
+			spread[ k ] = abs( score - evaluate( &pos[ k ] ) );
+			mean += spread[ k ];
+		}
+		qsort( spread, positions, sizeof( int ), cmpInt );
+		printf( "%-6d %8.0f %8d %8d %8d\n", plies, mean / positions, spread[ positions * 90 / 100 ],
+			spread[ positions * 95 / 100 ], spread[ positions * 99 / 100 ] );
+	}
+
+	free( spread );
+}
+
+/**********************************************************/
+void comparePruning( Position * pos, int positions, int depth )
+{
+	long long nodes[ 2 ] = { 0, 0 };
+	double time[ 2 ] = { 0, 0 }, error = 0;
+	int k, r, score[ 2 ], same = 0;
+	Move best[ 2 ];
+	SearchStats pruned;
+	struct timespec t0, t1;
+
+	memset( &pruned, 0, sizeof( pruned ) );
+
+	for( k = 0; k < positions; k++ )
+	{
+		for( r = 0; r < 2; r++ )
+		{
+			forwardPruning = r;
+			memset( &searchStats, 0, sizeof( searchStats ) );
+			clock_gettime( CLOCK_MONOTONIC, &t0 );
+			score[ r ] = rootSearch( &pos[ k ], pos[ k ].turn, TRUE, depth, &best[ r ] );
+			clock_gettime( CLOCK_MONOTONIC, &t1 );
+			nodes[ r ] += searchStats.nodes + searchStats.leaves;
+			time[ r ] += seconds( &t0, &t1 );
+		}
+		addStats( &pruned, &searchStats );
+		same += ( best[ 0 ].tile[ 0 ] == best[ 1 ].tile[ 0 ] && best[ 0 ].tile[ 1 ] == best[ 1 ].tile[ 1 ] );
+		error += abs( score[ 0 ] - score[ 1 ] );
+	}
+
+	printf( "depth %d, %d positions\n", depth, positions );
+	printf( "full width      %12lld nodes %9.3f s\n", nodes[ 0 ], time[ 0 ] );
+	printf( "forward pruning %12lld nodes %9.3f s (%.1f%% of the nodes)\n", nodes[ 1 ], time[ 1 ], 100.0 * nodes[ 1 ] / nodes[ 0 ] );
+	printf( "%lld futility cuts, %lld razor searches, %lld razor cuts\n", pruned.futilityPrunes, pruned.razorSearches, pruned.razorPrunes );
+	printf( "same best move in %.1f%% of the positions, mean score difference %.1f\n", 100.0 * same / positions, error / positions );
+}
+
+/**********************************************************/
+int comparePaging( Position * pos, int positions, int depth, int ttMB, int cacheMB )
+{
+	/* the same searches with the tables on 4KB or 2MB pages, without and with prefetching */
+	long long nodes;
+	double time, base = 0;
+	int k, r;
+	Move best;
+	struct timespec t0, t1;
+
+	printf( "depth %d, %d positions, %d MB transposition table, %d MB eval cache\n", depth, positions, ttMB, cacheMB );
+
+	for( r = 0; r < 4; r++ )
+	{
+		largePages = r >= 2;
+		searchPrefetch = r % 2;
+		if( initTT( ttMB, NULL ) < 0 || initEvalCache( cacheMB ) < 0 )
+			return 1;
+
+		nodes = 0;
+		time = 0;
+		for( k = 0; k < positions; k++ )
+		{
+			memset( &searchStats, 0, sizeof( searchStats ) );
+			ttNewSearch();
+			clock_gettime( CLOCK_MONOTONIC, &t0 );
+			rootSearch( &pos[ k ], pos[ k ].turn, TRUE, depth, &best );
+			clock_gettime( CLOCK_MONOTONIC, &t1 );
+			nodes += searchStats.nodes + searchStats.leaves;
+			time += seconds( &t0, &t1 );
+		}
+		if( r == 0 )
+			base = nodes / time;
+
+		printf( "%-11s pages, prefetch %-3s %12lld nodes %9.3f s %10.0f nps (%+.1f%%)\n", pagesName( ttPages ),
+			searchPrefetch ? "on" : "off", nodes, time, nodes / time, 100.0 * ( nodes / time - base ) / base );
+	}
+
+	return 0;
+}
+
+/**********************************************************/
+int main( int argc, char ** argv )
+{
+	int depth = 3, positions = 40;
+	int minEmpties = ENDGAME_EMPTIES * 8 / 10, maxEmpties = ENDGAME_EMPTIES * 24 / 10;
+	char * weightsFile = NULL;
+	Band bands[ MAX_BANDS ], total;
+	Position pos;
+	Move best;
+	struct timespec t0, t1;
+	char name[ 32 ];
+	unsigned int seed;
+	int c, k, empties, b, kernels = FALSE, cacheMB = EVAL_CACHE_MB, ttMB = 0, mode = 0;
+
+	opterr = 0;
+	while( ( c = getopt( argc, argv, "d:n:s:r:e:w:c:t:LFPNmapkh" ) ) != -1 )
+		switch( c )
+		{
+			case 'h':
+				printf( "[-d depth] [-n positions] [-s seed] [-r min_empties:max_empties] [-e classic|pattern|nnue] [-w weights_file] [-c eval_cache_MB] [-t hash_MB] [-L (no lazy evaluation)] [-F (no forward pruning)] [-P (no 2MB pages)] [-N (no prefetch)] [-m (measure pruning margins)] [-a (compare with and without forward pruning)] [-p (compare page sizes and prefetch)] [-k (check the feature kernels)]\n" );
+				return 0;
+			case 'd':
+				depth = atoi( optarg );
+				break;
+			case 'n':
+				positions = atoi( optarg );
+				break;
+			case 's':
+				benchSeed = atoi( optarg );
+				break;
+			case 'r':
+				if( sscanf( optarg, "%d:%d", &minEmpties, &maxEmpties ) != 2 || minEmpties < 1 || maxEmpties < minEmpties || maxEmpties > HEX_CELLS - 8 )
+				{
+					printf( "Bad range %s\n", optarg );
+					return 1;
+				}
+				break;
+			case 'e':
+				evaluator = ( strcmp( optarg, "pattern" ) == 0 ) ? EVAL_PATTERN : ( strcmp( optarg, "nnue" ) == 0 ) ? EVAL_NNUE : EVAL_CLASSIC;
+				break;
+			case 'w':
+				weightsFile = optarg;
+				break;
+			case 'c':
+				cacheMB = atoi( optarg );
+				break;
+			case 't':
+				ttMB = atoi( optarg );
+				break;
+			case 'L':
+				lazyEval = FALSE;
+				break;
+			case 'F':
+				forwardPruning = FALSE;
+				break;
+			case 'P':
+				largePages = FALSE;
+				break;
+			case 'N':
+				searchPrefetch = FALSE;
+				break;
+			case 'm':
+			case 'a':
+			case 'p':
+				mode = c;
+				break;
+			case 'k':
+				kernels = TRUE;
+				break;
+			case '?':
+				if( isprint( optopt ) )
+					printf( "Unknown option or missing argument -%c\n", ( char ) optopt );
+				else
+					printf( "Unknown option character -%c\n", ( char ) optopt );
+				return 1;
+			default:
+				return 1;
+		}
+
+	if( evaluator == EVAL_NNUE && weightsFile == NULL )
+	{
+		printf( "The nnue evaluation needs a network (-w network_file)\n" );
+		return 1;
+	}
+
+	if( weightsFile != NULL )
+	{
+		if( evaluator == EVAL_NNUE && loadNetwork( weightsFile ) < 0 )
+			return 1;
+		if( evaluator == EVAL_PATTERN && loadPatternWeights( weightsFile ) < 0 )
+			return 1;
+		if( evaluator == EVAL_CLASSIC && loadEvalWeights( weightsFile ) < 0 )
+			return 1;
+	}
+
+	initBitBoards();
+	if( kernels )
+		return checkKernels( positions, 1, HEX_CELLS - 5 );
+
+	if( initEvalCache( cacheMB ) < 0 || initTT( ttMB, NULL ) < 0 )
+		return 1;
+
+	seed = benchSeed;
+	if( mode )
+	{
+		Position * set = malloc( sizeof( Position ) * positions );
+
+		for( k = 0; k < positions; k++ )
+			while( !randomPosition( &set[ k ], maxEmpties - k % ( maxEmpties - minEmpties + 1 ) ) )
+				;
+		if( mode == 'm' )
+			measureMargins( set, positions );
+		else if( mode == 'p' )
+			k = comparePaging( set, positions, depth, ttMB > 0 ? ttMB : TT_MB, cacheMB );
+		else
+			comparePruning( set, positions, depth );
+		free( set );
+		return mode == 'p' ? k : 0;
+	}
+
+	memset( bands, 0, sizeof( bands ) );
+	memset( &total, 0, sizeof( total ) );
+
+	for( k = 0; k < positions; k++ )
+	{
+		/* targets cycle through the range */
+		empties = maxEmpties - k % ( maxEmpties - minEmpties + 1 );
+		while( !randomPosition( &pos, empties ) )
+			;
+		empties = HEX_CELLS - pos.score[ WHITE ] - pos.score[ BLACK ];
+
+		memset( &searchStats, 0, sizeof( searchStats ) );
+		ttNewSearch();
+		clock_gettime( CLOCK_MONOTONIC, &t0 );
+		rootSearch( &pos, pos.turn, TRUE, depth, &best );
+		clock_gettime( CLOCK_MONOTONIC, &t1 );
+
+		b = empties / BAND_WIDTH;
+		bands[ b ].positions++;
+		bands[ b ].seconds += seconds( &t0, &t1 );
+		addStats( &bands[ b ].stats, &searchStats );
+	}
+
+	printf( "depth %d, %d positions, %d-%d empties, seed %u, disc-count endgame at <= %d empties\n\n",
+		depth, positions, minEmpties, maxEmpties, seed, ENDGAME_EMPTIES - 1 );
+	printf( "%-10s %5s %12s %9s %10s %10s %8s %8s\n", "empties", "pos", "nodes", "seconds", "nps", "cutoffs", "first", "stable" );
+
+	for( b = MAX_BANDS - 1; b >= 0; b-- )
+	{
+		if( bands[ b ].positions == 0 )
+			continue;
+		sprintf( name, "%d-%d", b * BAND_WIDTH, b * BAND_WIDTH + BAND_WIDTH - 1 );
+		printBand( name, &bands[ b ] );
+
+		total.positions += bands[ b ].positions;
+		total.seconds += bands[ b ].seconds;
+		addStats( &total.stats, &bands[ b ].stats );
+	}
+	printBand( "total", &total );
+
+	printf( "\n" );
+	if( evalCacheBytes() > 0 )
+		printf( "eval cache %zu KB, %lld probes, %.1f%% hits\n", evalCacheBytes() >> 10, evalStats.probes,
+			evalStats.probes ? 100.0 * evalStats.hits / evalStats.probes : 0.0 );
+	if( ttBytes() > 0 )
+		printf( "transposition table %zu MB (%s pages), %lld probes, %.1f%% hits, %lld cutoffs\n", ttBytes() >> 20, pagesName( ttPages ), ttStats.probes,
+			ttStats.probes ? 100.0 * ttStats.hits / ttStats.probes : 0.0, ttStats.cutoffs );
+	if( forwardPruning )
+		printf( "forward pruning: %lld futility cuts, %lld razor searches, %lld razor cuts\n",
+			total.stats.futilityPrunes, total.stats.razorSearches, total.stats.razorPrunes );
+	if( lazyEval )
+		printf( "lazy evaluation: %lld exits after stage 1, %lld after stage 2\n", evalStats.lazyExits[ 0 ], evalStats.lazyExits[ 1 ] );
+
+	return 0;
+}
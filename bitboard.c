@@ -0,0 +1,182 @@
+#include "bitboard.h"
+
+/* the AVX2 kernel holds a whole bitboard in one 256 bit register */
+#if defined( __x86_64__ ) && defined( __GNUC__ ) && BB_WORDS == 4
+#define BB_AVX2_KERNEL
+#include <immintrin.h>
+#define BB_AVX2 __attribute__( ( target( "avx2,popcnt" ) ) )
+#endif
+
+/**********************************************************/
+BitBoard bbValid;
+BitBoard bbLines[ BB_AXES ][ ARRAY_BOARD_SIZE ];
+BitBoard bbBorder;
+const int bbAxisShift[ BB_AXES ] = { BB_AXIS_ROW, BB_AXIS_COL, BB_AXIS_DIAG };
+int bbHasAVX2 = FALSE;
+void ( * bbFeatures )( BitBoard pieces[ 2 ], BitBoard illegal, BBFeatures * f ) = bbFeaturesScalar;
+
+static int bbInitialized = FALSE;
+
+/**********************************************************/
+void initBitBoards( void )	//uses the same geometry as initPosition()
+{
+	int i, j;
+	int illegalPerRow = HEX_BOARD_RADIUS;
+
+	if( bbInitialized )
+		return;
+
+	bbValid = bbZero();
+
+	for( i = 0; i < ARRAY_BOARD_SIZE; i++ )
+	{
+		for( j = 0; j < ARRAY_BOARD_SIZE; j++ )
+			if( !( illegalPerRow > j || (illegalPerRow < 0 && (j >= illegalPerRow + ARRAY_BOARD_SIZE)) ) )
+				bbSet( &bbValid, BB_INDEX( i, j ) );
+		illegalPerRow--;
+	}
+
+	/* border: tiles with a neighbour missing in any of the six directions */
+	bbBorder = bbZero();
+	for( i = 0; i < BB_AXES; i++ )
+		bbBorder = bbOr( bbBorder, bbAndNot( bbValid, bbAnd( bbShiftUp( bbValid, bbAxisShift[ i ] ), bbShiftDown( bbValid, bbAxisShift[ i ] ) ) ) );
+
+	/* lines: rows (i), columns (j) and the other diagonal (i + j - HEX_BOARD_RADIUS) */
+	for( i = 0; i < ARRAY_BOARD_SIZE; i++ )
+	{
+		bbLines[ 0 ][ i ] = bbZero();
+		bbLines[ 1 ][ i ] = bbZero();
+		bbLines[ 2 ][ i ] = bbZero();
+	}
+
+	for( i = 0; i < ARRAY_BOARD_SIZE; i++ )
+		for( j = 0; j < ARRAY_BOARD_SIZE; j++ )
+			if( bbTest( bbValid, BB_INDEX( i, j ) ) )
+			{
+				bbSet( &bbLines[ 0 ][ i ], BB_INDEX( i, j ) );
+				bbSet( &bbLines[ 1 ][ j ], BB_INDEX( i, j ) );
+				bbSet( &bbLines[ 2 ][ i + j - HEX_BOARD_RADIUS ], BB_INDEX( i, j ) );
+			}
+
+#ifdef BB_AVX2_KERNEL
+	__builtin_cpu_init();
+	bbHasAVX2 = __builtin_cpu_supports( "avx2" ) && __builtin_cpu_supports( "popcnt" );
+#endif
+	bbFeatures = bbHasAVX2 ? bbFeaturesAVX2 : bbFeaturesScalar;
+
+	bbInitialized = TRUE;
+}
+
+/**********************************************************/
+int bbFirst( BitBoard b )
+{
+	int k;
+
+	for( k = 0; k < BB_WORDS; k++ )
+		if( b.w[ k ] )
+			return k * 64 + __builtin_ctzll( b.w[ k ] );
+
+	return -1;
+}
+
+/**********************************************************/
+BitBoard bbFill( BitBoard seed, BitBoard mask )
+{
+	BitBoard next;
+
+	seed = bbAnd( seed, mask );
+
+	while( 1 )
+	{
+		next = bbAnd( bbOr( seed, bbNeighbours( seed ) ), mask );
+		if( bbEqual( next, seed ) )
+			return seed;
+		seed = next;
+	}
+}
+
+/**********************************************************/
+void bbFeaturesScalar( BitBoard pieces[ 2 ], BitBoard illegal, BBFeatures * f )
+{
+	BitBoard empties, nearEmpty;
+
+	empties = bbAndNot( bbValid, bbOr( bbOr( pieces[ WHITE ], pieces[ BLACK ] ), illegal ) );
+	nearEmpty = bbNeighbours( empties );
+
+	f->discs[ WHITE ] = bbCount( pieces[ WHITE ] );
+	f->discs[ BLACK ] = bbCount( pieces[ BLACK ] );
+	f->frontier[ WHITE ] = bbCount( bbAnd( pieces[ WHITE ], nearEmpty ) );
+	f->frontier[ BLACK ] = bbCount( bbAnd( pieces[ BLACK ], nearEmpty ) );
+	f->border[ WHITE ] = bbCount( bbAnd( pieces[ WHITE ], bbBorder ) );
+	f->border[ BLACK ] = bbCount( bbAnd( pieces[ BLACK ], bbBorder ) );
+	f->potMobility[ WHITE ] = bbCount( bbAnd( empties, bbNeighbours( pieces[ BLACK ] ) ) );
+	f->potMobility[ BLACK ] = bbCount( bbAnd( empties, bbNeighbours( pieces[ WHITE ] ) ) );
+}
+
+#ifdef BB_AVX2_KERNEL
+/**********************************************************/
+/* 256 bit shifts: shift each word, then carry the bits crossing a word into the next one */
+static BB_AVX2 inline __m256i avxShiftUp( __m256i v, const int n )
+{
+	__m256i carry = _mm256_srli_epi64( v, 64 - n );
+
+	carry = _mm256_permute4x64_epi64( carry, _MM_SHUFFLE( 2, 1, 0, 3 ) );
+	carry = _mm256_blend_epi32( carry, _mm256_setzero_si256(), 0x03 );
+	return _mm256_or_si256( _mm256_slli_epi64( v, n ), carry );
+}
+
+static BB_AVX2 inline __m256i avxShiftDown( __m256i v, const int n )
+{
+	__m256i carry = _mm256_slli_epi64( v, 64 - n );
+
+	carry = _mm256_permute4x64_epi64( carry, _MM_SHUFFLE( 0, 3, 2, 1 ) );
+	carry = _mm256_blend_epi32( carry, _mm256_setzero_si256(), 0xC0 );
+	return _mm256_or_si256( _mm256_srli_epi64( v, n ), carry );
+}
+
+static BB_AVX2 inline __m256i avxNeighbours( __m256i v, __m256i valid )
+{
+	__m256i r;
+
+	r = _mm256_or_si256( avxShiftUp( v, BB_AXIS_ROW ), avxShiftDown( v, BB_AXIS_ROW ) );
+	r = _mm256_or_si256( r, _mm256_or_si256( avxShiftUp( v, BB_AXIS_COL ), avxShiftDown( v, BB_AXIS_COL ) ) );
+	r = _mm256_or_si256( r, _mm256_or_si256( avxShiftUp( v, BB_AXIS_DIAG ), avxShiftDown( v, BB_AXIS_DIAG ) ) );
+
+	return _mm256_and_si256( r, valid );
+}
+
+static BB_AVX2 inline int avxCount( __m256i v )
+{
+	return __builtin_popcountll( _mm256_extract_epi64( v, 0 ) ) + __builtin_popcountll( _mm256_extract_epi64( v, 1 ) )
+		+ __builtin_popcountll( _mm256_extract_epi64( v, 2 ) ) + __builtin_popcountll( _mm256_extract_epi64( v, 3 ) );
+}
+
+/**********************************************************/
+BB_AVX2 void bbFeaturesAVX2( BitBoard pieces[ 2 ], BitBoard illegal, BBFeatures * f )
+{
+	__m256i valid = _mm256_loadu_si256( ( __m256i * ) bbValid.w );
+	__m256i border = _mm256_loadu_si256( ( __m256i * ) bbBorder.w );
+	__m256i white = _mm256_loadu_si256( ( __m256i * ) pieces[ WHITE ].w );
+	__m256i black = _mm256_loadu_si256( ( __m256i * ) pieces[ BLACK ].w );
+	__m256i blocked = _mm256_loadu_si256( ( __m256i * ) illegal.w );
+	__m256i empties, nearEmpty;
+
+	empties = _mm256_andnot_si256( _mm256_or_si256( _mm256_or_si256( white, black ), blocked ), valid );
+	nearEmpty = avxNeighbours( empties, valid );
+
+	f->discs[ WHITE ] = avxCount( white );
+	f->discs[ BLACK ] = avxCount( black );
+	f->frontier[ WHITE ] = avxCount( _mm256_and_si256( white, nearEmpty ) );
+	f->frontier[ BLACK ] = avxCount( _mm256_and_si256( black, nearEmpty ) );
+	f->border[ WHITE ] = avxCount( _mm256_and_si256( white, border ) );
+	f->border[ BLACK ] = avxCount( _mm256_and_si256( black, border ) );
+	f->potMobility[ WHITE ] = avxCount( _mm256_and_si256( empties, avxNeighbours( black, valid ) ) );
+	f->potMobility[ BLACK ] = avxCount( _mm256_and_si256( empties, avxNeighbours( white, valid ) ) );
+}
+#else
+/**********************************************************/
+void bbFeaturesAVX2( BitBoard pieces[ 2 ], BitBoard illegal, BBFeatures * f )
+{
+	bbFeaturesScalar( pieces, illegal, f );	//not built for this target, bbHasAVX2 stays FALSE
+}
+#endif
@@ -0,0 +1,183 @@
+#ifndef _BITBOARD_H
+#define _BITBOARD_H
+
+#include "global.h"
+#include <stdint.h>
+
+/**********************************************************/
+
+/*
+Bit layout:
+
+Cell ( row, col ) of the array board is bit ( row * BB_STRIDE + col ).
+Every row has one padding column more than the array board, so a shift
+by one column never moves a disc into the neighbouring row.
+
+The six hex neighbours of a cell are at bit offsets:
+	+-1 (same row), +-BB_STRIDE (same column), +-(BB_STRIDE - 1) (the other diagonal)
+which are exactly the six directions used by doAllDirections().
+*/
+#define BB_STRIDE ( ARRAY_BOARD_SIZE + 1 )
+#define BB_BITS ( ARRAY_BOARD_SIZE * BB_STRIDE )
+#define BB_WORDS ( ( BB_BITS + 63 ) / 64 )
+
+/* bit offset between neighbours along each of the three line axes */
+#define BB_AXES 3
+#define BB_AXIS_ROW 1
+#define BB_AXIS_COL BB_STRIDE
+#define BB_AXIS_DIAG ( BB_STRIDE - 1 )
+
+#define BB_INDEX( row, col ) ( ( row ) * BB_STRIDE + ( col ) )
+#define BB_ROW( index ) ( ( index ) / BB_STRIDE )
+#define BB_COL( index ) ( ( index ) % BB_STRIDE )
+
+/* Bitboard of the whole array board */
+typedef struct
+{
+	uint64_t w[ BB_WORDS ];
+} BitBoard;
+
+/* disc-level feature counts of both colors, see bbFeatures */
+typedef struct
+{
+	int discs[ 2 ];
+	int frontier[ 2 ];		//discs next to an empty tile
+	int border[ 2 ];		//discs on the outer ring
+	int potMobility[ 2 ];	//empty tiles next to an opponent disc
+} BBFeatures;
+
+/**********************************************************/
+extern BitBoard bbValid;		//every tile of the hexagon (ILLEGAL tiles are kept per position, see Position.illegal)
+extern BitBoard bbLines[ BB_AXES ][ ARRAY_BOARD_SIZE ];	//every full line of the hexagon, per axis
+extern BitBoard bbBorder;								//the outer ring of the hexagon (its six edges)
+extern const int bbAxisShift[ BB_AXES ];				//BB_AXIS_ROW, BB_AXIS_COL, BB_AXIS_DIAG
+extern int bbHasAVX2;									//TRUE if bbFeatures uses the AVX2 kernel
+
+extern void ( * bbFeatures )( BitBoard pieces[ 2 ], BitBoard illegal, BBFeatures * f );
+//feature counts of a position (illegal: its ILLEGAL tiles, never empty), AVX2 kernel if the cpu supports it, else the scalar one (set by initBitBoards())
+/**********************************************************/
+
+void initBitBoards( void );
+//computes the global masks (safe to call more than once)
+
+int bbFirst( BitBoard b );
+//index of the lowest set bit, -1 if b is empty
+
+BitBoard bbFill( BitBoard seed, BitBoard mask );
+//flood fills seed inside mask using hex adjacency (connected component of mask containing seed)
+
+void bbFeaturesScalar( BitBoard pieces[ 2 ], BitBoard illegal, BBFeatures * f );
+void bbFeaturesAVX2( BitBoard pieces[ 2 ], BitBoard illegal, BBFeatures * f );
+//the two implementations of bbFeatures (bbFeaturesAVX2 must only be called if bbHasAVX2)
+
+
+/**********************************************************/
+static inline BitBoard bbAnd( BitBoard a, BitBoard b )
+{
+	int k;
+	for( k = 0; k < BB_WORDS; k++ )
+		a.w[ k ] &= b.w[ k ];
+	return a;
+}
+
+static inline BitBoard bbOr( BitBoard a, BitBoard b )
+{
+	int k;
+	for( k = 0; k < BB_WORDS; k++ )
+		a.w[ k ] |= b.w[ k ];
+	return a;
+}
+
+static inline BitBoard bbAndNot( BitBoard a, BitBoard b )		//a & ~b
+{
+	int k;
+	for( k = 0; k < BB_WORDS; k++ )
+		a.w[ k ] &= ~b.w[ k ];
+	return a;
+}
+
+static inline int bbIsEmpty( BitBoard b )
+{
+	int k;
+	uint64_t acc = 0;
+	for( k = 0; k < BB_WORDS; k++ )
+		acc |= b.w[ k ];
+	return acc == 0;
+}
+
+static inline int bbEqual( BitBoard a, BitBoard b )
+{
+	int k;
+	uint64_t acc = 0;
+	for( k = 0; k < BB_WORDS; k++ )
+		acc |= a.w[ k ] ^ b.w[ k ];
+	return acc == 0;
+}
+
+static inline int bbCount( BitBoard b )
+{
+	int k, n = 0;
+	for( k = 0; k < BB_WORDS; k++ )
+		n += __builtin_popcountll( b.w[ k ] );
+	return n;
+}
+
+static inline int bbTest( BitBoard b, int index )
+{
+	return ( b.w[ index >> 6 ] >> ( index & 63 ) ) & 1;
+}
+
+static inline void bbSet( BitBoard * b, int index )
+{
+	b->w[ index >> 6 ] |= 1ULL << ( index & 63 );
+}
+
+static inline void bbClear( BitBoard * b, int index )
+{
+	b->w[ index >> 6 ] &= ~( 1ULL << ( index & 63 ) );
+}
+
+static inline BitBoard bbZero( void )
+{
+	BitBoard b;
+	int k;
+	for( k = 0; k < BB_WORDS; k++ )
+		b.w[ k ] = 0;
+	return b;
+}
+
+/* shift towards higher indices by n bits (0 < n < 64) */
+static inline BitBoard bbShiftUp( BitBoard b, int n )
+{
+	BitBoard r;
+	int k;
+	for( k = BB_WORDS - 1; k > 0; k-- )
+		r.w[ k ] = ( b.w[ k ] << n ) | ( b.w[ k - 1 ] >> ( 64 - n ) );
+	r.w[ 0 ] = b.w[ 0 ] << n;
+	return r;
+}
+
+/* shift towards lower indices by n bits (0 < n < 64) */
+static inline BitBoard bbShiftDown( BitBoard b, int n )
+{
+	BitBoard r;
+	int k;
+	for( k = 0; k < BB_WORDS - 1; k++ )
+		r.w[ k ] = ( b.w[ k ] >> n ) | ( b.w[ k + 1 ] << ( 64 - n ) );
+	r.w[ BB_WORDS - 1 ] = b.w[ BB_WORDS - 1 ] >> n;
+	return r;
+}
+
+/* all cells adjacent to a cell of b (b itself not included unless adjacent) */
+static inline BitBoard bbNeighbours( BitBoard b )
+{
+	BitBoard r;
+
+	r = bbOr( bbShiftUp( b, 1 ), bbShiftDown( b, 1 ) );
+	r = bbOr( r, bbOr( bbShiftUp( b, BB_STRIDE ), bbShiftDown( b, BB_STRIDE ) ) );
+	r = bbOr( r, bbOr( bbShiftUp( b, BB_STRIDE - 1 ), bbShiftDown( b, BB_STRIDE - 1 ) ) );
+
+	return bbAnd( r, bbValid );
+}
+
+#endif
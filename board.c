@@ -3,6 +3,44 @@
 #include <stdlib.h>
 #include <math.h>
 
+/* the six hex directions (the same ones doAllDirections() walks) */
+static const signed char incRow[ 6 ] = { -1, -1, 0, 0, 1, 1 };
+static const signed char incCol[ 6 ] = { 0, 1, -1, 1, -1, 0 };
+
+uint64_t zobristKeys[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ][ 2 ];
+uint64_t zobristSide;
+static int zobristInitialized = FALSE;
+
+/**********************************************************/
+static uint64_t splitMix64( uint64_t * state )
+{
+	uint64_t z = ( *state += 0x9E3779B97F4A7C15ULL );
+
+	z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+	z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+	return z ^ ( z >> 31 );
+}
+
+/**********************************************************/
+void initZobrist( void )
+{
+	/* fixed seed, so hashes are the same in every run and program */
+	uint64_t state = 0;
+	int i, j;
+
+	if( zobristInitialized )
+		return;
+
+	for( i = 0; i < ARRAY_BOARD_SIZE; i++ )
+		for( j = 0; j < ARRAY_BOARD_SIZE; j++ )
+		{
+			zobristKeys[ i ][ j ][ WHITE ] = splitMix64( &state );
+			zobristKeys[ i ][ j ][ BLACK ] = splitMix64( &state );
+		}
+	zobristSide = splitMix64( &state );
+
+	zobristInitialized = TRUE;
+}
 
 
 /**********************************************************/
@@ -35,6 +73,9 @@ void initPosition( Position * pos )		//to add illegal tiles change ONLY this fun
 	/* Black plays first */
 	pos->turn = BLACK;
 
+	/* Bitboards and empty regions */
+	syncPosition( pos );
+
 }
 
 
@@ -102,6 +143,50 @@ void printPosition( Position * pos )
 
 }
 
+/**********************************************************/
+static int hasEmptyNeighbour( Position * pos, int row, int col )
+{
+	int d, i, j;
+
+	for( d = 0; d < 6; d++ )
+	{
+		i = row + incRow[ d ];
+		j = col + incCol[ d ];
+		if( i >= 0 && i < ARRAY_BOARD_SIZE && j >= 0 && j < ARRAY_BOARD_SIZE && pos->board[ i ][ j ] == EMPTY )
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/**********************************************************/
+static void updateFeatures( Position * pos, int row, int col )
+{
+	/*
+	 * Called after a disc was put on (row, col). The new disc may be a frontier
+	 * disc, and its neighbours may have lost their last empty neighbour.
+	 * Flipped discs were already moved from one color's counts to the other's.
+	 */
+	int d, i, j;
+	int color = pos->board[ row ][ col ];
+
+	if( bbTest( bbBorder, BB_INDEX( row, col ) ) )
+		pos->border[ color ]++;
+
+	if( hasEmptyNeighbour( pos, row, col ) )
+		pos->frontier[ color ]++;
+
+	for( d = 0; d < 6; d++ )
+	{
+		i = row + incRow[ d ];
+		j = col + incCol[ d ];
+		if( i < 0 || i >= ARRAY_BOARD_SIZE || j < 0 || j >= ARRAY_BOARD_SIZE )
+			continue;
+		if( ( pos->board[ i ][ j ] == WHITE || pos->board[ i ][ j ] == BLACK ) && !hasEmptyNeighbour( pos, i, j ) )
+			pos->frontier[ (int) pos->board[ i ][ j ] ]--;	//(row, col) was its last empty neighbour
+	}
+}
+
 /**********************************************************/
 int doOneDirection( Position * pos, Move * moveToPlay, int do_move, signed char inc_row, signed char inc_col )
 {
@@ -149,12 +234,74 @@ int doOneDirection( Position * pos, Move * moveToPlay, int do_move, signed char
 		pos->board[ i ][ j ] = moveToPlay->color;
 		pos->score[ (int) moveToPlay->color ]++;
 		pos->score[ opponent ]--;
+		bbSet( &pos->pieces[ (int) moveToPlay->color ], BB_INDEX( i, j ) );
+		bbClear( &pos->pieces[ opponent ], BB_INDEX( i, j ) );
+
+		/* WHITE (digit 1) <-> BLACK (digit 2) */
+		patternUpdate( pos->patternIndex, i, j, ( moveToPlay->color == WHITE ) ? -1 : 1 );
+		if( nnueEnabled )
+			nnueFlip( pos->nnueAcc, i, j, opponent, moveToPlay->color );
+		pos->hash ^= zobristKeys[ i ][ j ][ opponent ] ^ zobristKeys[ i ][ j ][ (int) moveToPlay->color ];
+
+		/* a flipped disc keeps its frontier/border status but changes color */
+		if( bbTest( bbBorder, BB_INDEX( i, j ) ) )
+		{
+			pos->border[ (int) moveToPlay->color ]++;
+			pos->border[ opponent ]--;
+		}
+		if( hasEmptyNeighbour( pos, i, j ) )
+		{
+			pos->frontier[ (int) moveToPlay->color ]++;
+			pos->frontier[ opponent ]--;
+		}
 	}
 
 	return TRUE;
 
 }
 
+/**********************************************************/
+static void updateRegions( Position * pos, int filled )
+{
+	/*
+	 * Called after tile (filled) was taken. Only the region that contained
+	 * the tile can change: it shrinks by one and may split into up to three
+	 * parts, each of which touches one of the empty neighbours of (filled).
+	 */
+	BitBoard empties, seeds, part;
+	int size = 1;	//the filled tile itself
+
+	empties = emptyTiles( pos );
+	seeds = bbZero();
+	bbSet( &seeds, filled );
+	seeds = bbAnd( bbNeighbours( seeds ), empties );
+
+	/* flood fill the parts the old region broke into */
+	while( !bbIsEmpty( seeds ) )
+	{
+		part = bbZero();
+		bbSet( &part, bbFirst( seeds ) );
+		part = bbFill( part, empties );
+		seeds = bbAndNot( seeds, part );
+
+		pos->regions++;
+		size += bbCount( part );
+		if( bbCount( part ) & 1 )
+		{
+			pos->oddRegions++;
+			pos->oddEmpties = bbOr( pos->oddEmpties, part );
+		}
+		else
+			pos->oddEmpties = bbAndNot( pos->oddEmpties, part );
+	}
+
+	/* forget the old region */
+	pos->regions--;
+	if( size & 1 )
+		pos->oddRegions--;
+	bbClear( &pos->oddEmpties, filled );
+}
+
 /**********************************************************/
 int doAllDirections( Position * pos, Move * moveToPlay, int do_move )
 {
@@ -166,6 +313,7 @@ int doAllDirections( Position * pos, Move * moveToPlay, int do_move )
 	if( ( moveToPlay->tile[ 0 ] == NULL_MOVE ) && do_move)
 	{
 		pos->turn = getOtherSide( pos->turn );
+		pos->hash ^= zobristSide;
 		return TRUE;
 	}
 
@@ -186,6 +334,13 @@ int doAllDirections( Position * pos, Move * moveToPlay, int do_move )
 	if(legal && do_move) {
 		pos->board[ moveToPlay->tile[ 0 ] ][ moveToPlay->tile[ 1 ] ] = moveToPlay->color;
 		pos->score[ (int) moveToPlay->color ]++;
+		bbSet( &pos->pieces[ (int) moveToPlay->color ], BB_INDEX( moveToPlay->tile[ 0 ], moveToPlay->tile[ 1 ] ) );
+		updateRegions( pos, BB_INDEX( moveToPlay->tile[ 0 ], moveToPlay->tile[ 1 ] ) );
+		updateFeatures( pos, moveToPlay->tile[ 0 ], moveToPlay->tile[ 1 ] );
+		patternUpdate( pos->patternIndex, moveToPlay->tile[ 0 ], moveToPlay->tile[ 1 ], moveToPlay->color + 1 );
+		if( nnueEnabled )
+			nnueAdd( pos->nnueAcc, moveToPlay->tile[ 0 ], moveToPlay->tile[ 1 ], moveToPlay->color );
+		pos->hash ^= zobristKeys[ moveToPlay->tile[ 0 ] ][ moveToPlay->tile[ 1 ] ][ (int) moveToPlay->color ] ^ zobristSide;
 		pos->turn = getOtherSide( pos->turn );
 	}
 
@@ -224,18 +379,213 @@ int isLegal( Position * pos, short int row, short int col, char color)
 /**********************************************************/
 int canMove( Position * pos, char color)
 {
-	unsigned short int i,j;
+	return !bbIsEmpty( legalMoves( pos, color ) );
+}
+
+/**********************************************************/
+void syncPosition( Position * pos )
+{
+	int i, j;
+	BitBoard rest, part;
+	BBFeatures features;
+
+	initBitBoards();
+	initPatterns();
+	initZobrist();
+
+	pos->pieces[ WHITE ] = bbZero();
+	pos->pieces[ BLACK ] = bbZero();
+	pos->illegal = bbZero();
+	pos->hash = ( pos->turn == BLACK ) ? zobristSide : 0;
+
+	for( i = 0; i < ARRAY_BOARD_SIZE; i++ )
+		for( j = 0; j < ARRAY_BOARD_SIZE; j++ )
+		{
+			if( pos->board[ i ][ j ] == WHITE || pos->board[ i ][ j ] == BLACK )
+			{
+				bbSet( &pos->pieces[ (int) pos->board[ i ][ j ] ], BB_INDEX( i, j ) );
+				pos->hash ^= zobristKeys[ i ][ j ][ (int) pos->board[ i ][ j ] ];
+			}
+			else if( pos->board[ i ][ j ] == ILLEGAL )
+				bbSet( &pos->illegal, BB_INDEX( i, j ) );	//illegal tiles are never playable
+		}
+
+	pos->score[ WHITE ] = bbCount( pos->pieces[ WHITE ] );
+	pos->score[ BLACK ] = bbCount( pos->pieces[ BLACK ] );
+
+	/* frontier and border counts */
+	bbFeatures( pos->pieces, pos->illegal, &features );
+	pos->frontier[ WHITE ] = features.frontier[ WHITE ];
+	pos->frontier[ BLACK ] = features.frontier[ BLACK ];
+	pos->border[ WHITE ] = features.border[ WHITE ];
+	pos->border[ BLACK ] = features.border[ BLACK ];
+
+	computePatternIndices( pos->board, pos->patternIndex );
+	if( nnueEnabled )
+		nnueRefresh( pos->board, pos->nnueAcc );
 
-	for(i=0 ; i <ARRAY_BOARD_SIZE ; i++)
-		for (j=0 ; j <ARRAY_BOARD_SIZE ; j++)
+	/* empty regions from scratch */
+	pos->regions = 0;
+	pos->oddRegions = 0;
+	pos->oddEmpties = bbZero();
+
+	rest = emptyTiles( pos );
+	while( !bbIsEmpty( rest ) )
+	{
+		part = bbZero();
+		bbSet( &part, bbFirst( rest ) );
+		part = bbFill( part, rest );
+		rest = bbAndNot( rest, part );
+
+		pos->regions++;
+		if( bbCount( part ) & 1 )
 		{
-			if (isLegal(pos, i, j, color))
-				return TRUE;
+			pos->oddRegions++;
+			pos->oddEmpties = bbOr( pos->oddEmpties, part );
 		}
-	return FALSE;
+	}
+}
+
+/**********************************************************/
+BitBoard emptyTiles( Position * pos )
+{
+	return bbAndNot( bbValid, bbOr( bbOr( pos->pieces[ WHITE ], pos->pieces[ BLACK ] ), pos->illegal ) );
+}
+
+/**********************************************************/
+int getRegions( Position * pos, BitBoard regions[], int maxRegions )
+{
+	BitBoard rest;
+	int n = 0;
+
+	rest = emptyTiles( pos );
+	while( !bbIsEmpty( rest ) && n < maxRegions )
+	{
+		regions[ n ] = bbZero();
+		bbSet( &regions[ n ], bbFirst( rest ) );
+		regions[ n ] = bbFill( regions[ n ], rest );
+		rest = bbAndNot( rest, regions[ n ] );
+		n++;
+	}
+
+	return n;
+}
+
+/**********************************************************/
+BitBoard legalMoves( Position * pos, char color )
+{
+	return bbAndNot( legalMovesOf( pos->pieces[ (int) color ], pos->pieces[ getOtherSide( (int) color ) ] ), pos->illegal );
+}
+
+/**********************************************************/
+BitBoard legalMovesOf( BitBoard own, BitBoard opp )
+{
+	/*
+	 * For each of the six directions: grow runs of opponent discs that start
+	 * next to one of our discs, then an empty tile right after a run is a move.
+	 * A run can not be longer than ARRAY_BOARD_SIZE - 2 discs.
+	 */
+	BitBoard empties, run, next, moves;
+	int a, k;
+
+	empties = bbAndNot( bbValid, bbOr( own, opp ) );
+	moves = bbZero();
+
+	for( a = 0; a < BB_AXES; a++ )
+	{
+		//towards higher indices
+		run = bbAnd( bbShiftUp( own, bbAxisShift[ a ] ), opp );
+		for( k = 0; k < ARRAY_BOARD_SIZE - 3 && !bbIsEmpty( run ); k++ )
+		{
+			next = bbOr( run, bbAnd( bbShiftUp( run, bbAxisShift[ a ] ), opp ) );
+			if( bbEqual( next, run ) )
+				break;
+			run = next;
+		}
+		moves = bbOr( moves, bbShiftUp( run, bbAxisShift[ a ] ) );
+
+		//towards lower indices
+		run = bbAnd( bbShiftDown( own, bbAxisShift[ a ] ), opp );
+		for( k = 0; k < ARRAY_BOARD_SIZE - 3 && !bbIsEmpty( run ); k++ )
+		{
+			next = bbOr( run, bbAnd( bbShiftDown( run, bbAxisShift[ a ] ), opp ) );
+			if( bbEqual( next, run ) )
+				break;
+			run = next;
+		}
+		moves = bbOr( moves, bbShiftDown( run, bbAxisShift[ a ] ) );
+	}
+
+	return bbAnd( moves, empties );
 }
 
+/**********************************************************/
+BitBoard flippedDiscs( Position * pos, Move * move )
+{
+	/* same walk as doOneDirection(), without changing anything */
+	BitBoard flips = bbZero(), line;
+	int d, i, j, opponent = getOtherSide( move->color );
 
+	for( d = 0; d < 6; d++ )
+	{
+		line = bbZero();
+		i = move->tile[ 0 ] + incRow[ d ];
+		j = move->tile[ 1 ] + incCol[ d ];
 
+		while( i >= 0 && i < ARRAY_BOARD_SIZE && j >= 0 && j < ARRAY_BOARD_SIZE && pos->board[ i ][ j ] == opponent )
+		{
+			bbSet( &line, BB_INDEX( i, j ) );
+			i += incRow[ d ];
+			j += incCol[ d ];
+		}
 
+		if( i >= 0 && i < ARRAY_BOARD_SIZE && j >= 0 && j < ARRAY_BOARD_SIZE && pos->board[ i ][ j ] == move->color )
+			flips = bbOr( flips, line );
+	}
+
+	return flips;
+}
+
+/**********************************************************/
+BitBoard stableDiscs( Position * pos, char color )
+{
+	/*
+	 * A disc is stable along an axis if its line on that axis is full, or one of
+	 * its two neighbours on that axis is off the board or an own stable disc.
+	 * A disc stable along all three axes can never be flipped. Starting from
+	 * nothing, the first pass finds the six corners and each further pass grows
+	 * the set along the edges and full lines until nothing changes.
+	 */
+	BitBoard occupied, own, stable, next, safe[ BB_AXES ], axisOk;
+	int a, l;
+
+	occupied = bbOr( pos->pieces[ WHITE ], pos->pieces[ BLACK ] );
+	own = pos->pieces[ (int) color ];
+
+	/* per axis: tiles that cannot be flipped along that axis whatever happens */
+	for( a = 0; a < BB_AXES; a++ )
+	{
+		//line ends (the neighbour on one side is missing)
+		safe[ a ] = bbAndNot( bbValid, bbAnd( bbShiftUp( bbValid, bbAxisShift[ a ] ), bbShiftDown( bbValid, bbAxisShift[ a ] ) ) );
 
+		//full lines
+		for( l = 0; l < ARRAY_BOARD_SIZE; l++ )
+			if( bbEqual( bbAnd( occupied, bbLines[ a ][ l ] ), bbAnd( bbValid, bbLines[ a ][ l ] ) ) )
+				safe[ a ] = bbOr( safe[ a ], bbLines[ a ][ l ] );
+	}
+
+	stable = bbZero();
+	while( 1 )
+	{
+		next = own;
+		for( a = 0; a < BB_AXES; a++ )
+		{
+			axisOk = bbOr( safe[ a ], bbOr( bbShiftUp( stable, bbAxisShift[ a ] ), bbShiftDown( stable, bbAxisShift[ a ] ) ) );
+			next = bbAnd( next, axisOk );
+		}
+
+		if( bbEqual( next, stable ) )
+			return stable;
+		stable = next;
+	}
+}
@@ -3,6 +3,9 @@
 
 #include "global.h"
 #include "move.h"
+#include "bitboard.h"
+#include "pattern.h"
+#include "nnue.h"
 /**********************************************************/
 
 /* Position struct to store board, score and player's turn */
@@ -11,8 +14,22 @@ typedef struct
 	char board[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ];
 	int score[ 2 ];
 	char turn;												//stores the color of the player that has the turn
+	BitBoard pieces[ 2 ];									//discs of each color, kept in sync with board by doMove()
+	BitBoard oddEmpties;									//empty tiles that belong to an odd sized empty region
+	BitBoard illegal;										//ILLEGAL tiles (never playable), set by syncPosition()
+	unsigned char regions;									//number of connected empty regions
+	unsigned char oddRegions;								//number of odd sized empty regions
+	short frontier[ 2 ];									//discs of each color next to an empty tile
+	short border[ 2 ];										//discs of each color on the outer ring of the hexagon
+	unsigned short patternIndex[ PATTERN_INSTANCES ];		//base-3 index of every pattern instance (see pattern.h)
+	short nnueAcc[ NNUE_HIDDEN ];							//hidden layer of the network before activation (only with nnueEnabled, see nnue.h)
+	uint64_t hash;											//Zobrist hash of the discs and the side to move
 } Position;
 
+/**********************************************************/
+extern uint64_t zobristKeys[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ][ 2 ];	//one key per (tile, color)
+extern uint64_t zobristSide;												//xored in when BLACK is to move
+
 
 /**********************************************************/
 void initPosition( Position * pos );
@@ -43,4 +60,29 @@ int isLegal( Position * pos, short int row, short int col, char color);
 int canMove( Position * pos, char color);
 //checks if player (color) can move on that specific position.
 
+void initZobrist( void );
+//computes the hash keys (safe to call more than once, syncPosition() does it)
+
+void syncPosition( Position * pos );
+//rebuilds bitboards, score, empty regions, frontier/border counts, pattern indices, the network accumulator and the hash from pos->board and pos->turn (call after filling board by hand)
+
+BitBoard emptyTiles( Position * pos );
+//bitboard of the empty tiles
+
+int getRegions( Position * pos, BitBoard regions[], int maxRegions );
+//splits the empty tiles into connected regions (hex adjacency), returns the number of regions stored
+
+BitBoard legalMoves( Position * pos, char color );
+//bitboard of every legal move of color (same answer as isLegal() on each tile)
+
+BitBoard legalMovesOf( BitBoard own, BitBoard opp );
+//legal moves of the side with discs own against discs opp on the whole hexagon (legalMoves() without a Position,
+//mask out its ILLEGAL tiles)
+
+BitBoard flippedDiscs( Position * pos, Move * move );
+//discs that move would flip (empty if it is not legal)
+
+BitBoard stableDiscs( Position * pos, char color );
+//discs of color that can never be flipped again (conservative: may miss some stable discs)
+
 #endif
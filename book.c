@@ -0,0 +1,195 @@
+#include "book.h"
+#include "symmetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BOOK_LINEAR_SEARCH 8		//ranges this small are scanned
+
+/**********************************************************/
+BookEntry * bookEntries = NULL;
+uint64_t bookSize = 0;
+
+static void * bookMap = NULL;
+static size_t bookMapBytes = 0;
+
+/**********************************************************/
+int openBook( char * fileName )
+{
+	struct stat st;
+	BookHeader * header;
+	void * map;
+	int fd;
+
+	closeBook();
+	initSymmetry();
+
+	if( ( fd = open( fileName, O_RDONLY ) ) < 0 )
+	{
+		printf( "ERROR: Cannot open book %s\n", fileName );
+		return -1;
+	}
+
+	if( fstat( fd, &st ) < 0 || st.st_size < ( off_t ) sizeof( BookHeader ) )
+	{
+		printf( "ERROR: %s is not a book\n", fileName );
+		close( fd );
+		return -1;
+	}
+
+	map = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );		//the mapping keeps the file
+	if( map == MAP_FAILED )
+	{
+		printf( "ERROR: Cannot map book %s\n", fileName );
+		return -1;
+	}
+
+	header = map;
+	if( header->magic != BOOK_FILE_MAGIC || header->version != BOOK_FILE_VERSION || header->radius != HEX_BOARD_RADIUS
+		|| ( uint64_t ) st.st_size != sizeof( BookHeader ) + header->entries * sizeof( BookEntry ) )
+	{
+		printf( "ERROR: %s is not a book for this board\n", fileName );
+		munmap( map, st.st_size );
+		return -1;
+	}
+
+	madvise( map, st.st_size, MADV_RANDOM );		//probes touch a few pages, do not read ahead
+
+	bookMap = map;
+	bookMapBytes = st.st_size;
+	bookEntries = ( BookEntry * ) ( header + 1 );
+	bookSize = header->entries;
+
+	return 0;
+}
+
+/**********************************************************/
+void closeBook( void )
+{
+	if( bookMap != NULL )
+		munmap( bookMap, bookMapBytes );
+
+	bookMap = NULL;
+	bookMapBytes = 0;
+	bookEntries = NULL;
+	bookSize = 0;
+}
+
+/**********************************************************/
+BookEntry * bookFind( uint64_t hash, int * count )
+{
+	/* hashes are uniform, so interpolation finds the range in a few probes */
+	uint64_t lo = 0, hi, mid;
+	BookEntry * e = bookEntries;
+
+	*count = 0;
+	if( bookSize == 0 )
+		return NULL;
+	hi = bookSize - 1;
+
+	while( hi - lo >= BOOK_LINEAR_SEARCH && hash > e[ lo ].hash && hash < e[ hi ].hash )
+	{
+		mid = lo + ( uint64_t ) ( ( long double ) ( hash - e[ lo ].hash ) / ( e[ hi ].hash - e[ lo ].hash ) * ( hi - lo ) );
+		if( mid <= lo )
+			mid = lo + 1;
+		if( mid >= hi )
+			mid = hi - 1;
+
+		if( e[ mid ].hash < hash )
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	if( hash >= e[ hi ].hash )
+		lo = hi;
+	else
+		while( lo < hi && e[ lo ].hash < hash )
+			lo++;
+	if( e[ lo ].hash != hash )
+		return NULL;
+
+	while( lo > 0 && e[ lo - 1 ].hash == hash )		//entries of one position are next to each other
+		lo--;
+	while( lo + *count < bookSize && e[ lo + *count ].hash == hash )
+		( *count )++;
+
+	return &e[ lo ];
+}
+
+/**********************************************************/
+int bookProbe( Position * pos, Move * move )
+{
+	BookEntry * e, * best = NULL;
+	int count, sym, k;
+
+	if( bookEntries == NULL )
+		return FALSE;
+
+	if( ( e = bookFind( canonicalHash( pos, &sym ), &count ) ) == NULL )
+		return FALSE;
+
+	for( k = 0; k < count; k++ )
+		if( best == NULL || e[ k ].score > best->score || ( e[ k ].score == best->score && e[ k ].visits > best->visits ) )
+			best = &e[ k ];
+
+	move->color = pos->turn;
+	if( best->move == BOOK_NULL_MOVE )
+		move->tile[ 0 ] = NULL_MOVE;
+	else
+	{
+		move->tile[ 0 ] = best->move / ARRAY_BOARD_SIZE;
+		move->tile[ 1 ] = best->move % ARRAY_BOARD_SIZE;
+		symTransformMove( move, symInverse[ sym ] );	//back from the canonical image
+	}
+
+	/* a hash collision must not make us play an illegal move */
+	if( move->tile[ 0 ] == NULL_MOVE ? canMove( pos, pos->turn ) : !isLegalMove( pos, move ) )
+		return FALSE;
+
+	return TRUE;
+}
+
+/**********************************************************/
+static int compareEntries( const void * a, const void * b )
+{
+	const BookEntry * x = a, * y = b;
+
+	if( x->hash != y->hash )
+		return x->hash < y->hash ? -1 : 1;
+	return x->move - y->move;
+}
+
+/**********************************************************/
+int writeBook( char * fileName, BookEntry * entries, uint64_t count )
+{
+	BookHeader header = { BOOK_FILE_MAGIC, BOOK_FILE_VERSION, HEX_BOARD_RADIUS, 0, count };
+	FILE * f;
+
+	qsort( entries, count, sizeof( BookEntry ), compareEntries );
+
+	if( ( f = fopen( fileName, "wb" ) ) == NULL )
+	{
+		printf( "ERROR: Cannot create book %s\n", fileName );
+		return -1;
+	}
+
+	if( fwrite( &header, sizeof( header ), 1, f ) != 1 || fwrite( entries, sizeof( BookEntry ), count, f ) != count )
+	{
+		printf( "ERROR: Cannot write book %s\n", fileName );
+		fclose( f );
+		return -1;
+	}
+
+	if( fclose( f ) != 0 )
+	{
+		printf( "ERROR: Cannot write book %s\n", fileName );
+		return -1;
+	}
+
+	return 0;
+}
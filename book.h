@@ -0,0 +1,61 @@
+#ifndef _BOOK_H
+#define _BOOK_H
+
+#include "global.h"
+#include "board.h"
+#include "move.h"
+
+/**********************************************************/
+
+/*
+Opening book:
+
+A binary file, memory-mapped read-only by openBook() (nothing is parsed, pages
+are read by the kernel when a probe touches them):
+	BookHeader
+	BookEntry[ entries ]	sorted by hash, one entry per (position, move)
+
+Positions are keyed by canonicalHash(), so the 12 images of a position share
+their entries. Moves are stored for the canonical image (the image under the
+symmetry canonicalHash() returns) and mapped back to the position on a probe.
+Scores are from the point of view of the side to move.
+*/
+#define BOOK_FILE_MAGIC 0x4B425848		//"HXBK"
+#define BOOK_FILE_VERSION 1
+#define BOOK_NULL_MOVE -1				//BookEntry.move of a pass
+
+typedef struct
+{
+	int magic, version, radius, reserved;
+	uint64_t entries;
+} BookHeader;
+
+typedef struct
+{
+	uint64_t hash;				//canonicalHash() of the position
+	short move;					//row * ARRAY_BOARD_SIZE + col in the canonical image, BOOK_NULL_MOVE to pass
+	short score;				//score of the move (side to move)
+	unsigned int visits;		//games or searches that went through the move
+} BookEntry;
+
+/**********************************************************/
+extern BookEntry * bookEntries;		//the mapped table, NULL if no book is open
+extern uint64_t bookSize;			//number of entries
+/**********************************************************/
+
+int openBook( char * fileName );
+//maps a book file, returns 0 on success and -1 on failure
+
+void closeBook( void );
+//unmaps the book
+
+BookEntry * bookFind( uint64_t hash, int * count );
+//entries of a canonical hash (interpolation search), NULL and *count = 0 if there are none
+
+int bookProbe( Position * pos, Move * move );
+//TRUE and the book move of the side to move (best score, then most visits) if pos is in the book
+
+int writeBook( char * fileName, BookEntry * entries, uint64_t count );
+//sorts entries and writes a book file, returns 0 on success and -1 on failure
+
+#endif
@@ -0,0 +1,685 @@
+#include "global.h"
+#include "board.h"
+#include "eval.h"
+#include "minimax.h"
+#include "symmetry.h"
+#include "pack.h"
+#include "book.h"
+#include "engine.h"
+#include "nnue.h"
+#include "pattern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/*
+ * Opening book builder (drop-out expansion).
+ *
+ * The book is a graph of positions (canonical images, so transpositions and
+ * symmetric lines meet). Every move of a book position is searched to a fixed
+ * depth; a move whose position is also in the book takes the negated value of
+ * that position instead (negamax from the side to move). The cost of a move
+ * that drops out of the book is the sum, from the root, of how much worse than
+ * the best move each move on the way is, plus a cost per ply. Every round the
+ * cheapest drop-outs are added to the book, the moves of the new positions are
+ * searched by a pool of threads and the values are backed up to the root.
+ *
+ * The state is checkpointed to a file (written to a temporary file and renamed),
+ * and an existing state file is resumed. The book (book.h) is written with it.
+ */
+
+#define MAX_THREADS 64
+#define STATE_FILE_MAGIC 0x53425848		//"HXBS"
+#define STATE_FILE_VERSION 1
+#define SCORE_LIMIT 32000				//scores are stored as shorts
+
+/**********************************************************/
+typedef struct
+{
+	short move;					// as in BookEntry
+	short score;				// search score (side to move)
+	int child;					// book position after the move, -1 while the move drops out of the book
+	unsigned int visits;		// expansions made through the move
+} BookMove;
+
+typedef struct
+{
+	uint64_t hash;									// canonicalHash() of the position
+	unsigned char packed[ PACKED_POSITION_BYTES ];	// its canonical image
+	short ply;										// plies from the root when it was added
+	short moveCount;								// -1 until its moves are searched, 0 at the end of the game
+	short final;									// score at the end of the game (side to move)
+	BookMove * moves;
+} BookNode;
+
+typedef struct
+{
+	int node, move;				// move to search
+	Position pos;				// position after the move
+} SearchJob;
+
+typedef struct
+{
+	long long cost;
+	int node, move;
+} Dropout;
+
+/**********************************************************/
+BookNode * nodes = NULL;
+int nodeCount = 0, nodeCapacity = 0;
+int * table = NULL;				// open addressing: hash -> node (-1 empty)
+uint64_t tableMask = 0;
+
+SearchJob * jobs = NULL;
+int jobCount = 0, jobCapacity = 0, nextJob = 0;
+pthread_mutex_t jobLock = PTHREAD_MUTEX_INITIALIZER;
+Engine engine;					// settings of the searching threads
+
+int threads = 4;
+int searchDepth = 8;			// plies searched after each move
+int maxPly = 20;				// positions deeper than this are not added
+int plyCost = 200;				// cost of each ply of a drop-out, in evaluation units
+
+int * value;					// per node, side to move
+long long * cost;				// per node, cheapest path from the root
+int * parentNode, * parentMove;
+
+/**********************************************************/
+static int clampScore( int score )
+{
+	return score > SCORE_LIMIT ? SCORE_LIMIT : ( score < -SCORE_LIMIT ? -SCORE_LIMIT : score );
+}
+
+/**********************************************************/
+int findNode( uint64_t hash )
+{
+	uint64_t i;
+
+	for( i = hash & tableMask; table[ i ] >= 0; i = ( i + 1 ) & tableMask )
+		if( nodes[ table[ i ] ].hash == hash )
+			return table[ i ];
+
+	return -1;
+}
+
+/**********************************************************/
+void insertNode( int n )
+{
+	uint64_t i, size;
+
+	if( ( uint64_t ) nodeCount * 2 > tableMask )	// grow and rehash at half load
+	{
+		size = ( tableMask + 1 ) * 2 < 1024 ? 1024 : ( tableMask + 1 ) * 2;
+		free( table );
+		if( ( table = malloc( sizeof( int ) * size ) ) == NULL )
+		{
+			printf( "ERROR: Out of memory after %d positions\n", nodeCount );
+			exit( 1 );
+		}
+		memset( table, -1, sizeof( int ) * size );
+		tableMask = size - 1;
+		for( i = 0; i < ( uint64_t ) nodeCount; i++ )
+			if( ( int ) i != n )
+				insertNode( i );
+	}
+
+	for( i = nodes[ n ].hash & tableMask; table[ i ] >= 0; i = ( i + 1 ) & tableMask )
+		;
+	table[ i ] = n;
+}
+
+/**********************************************************/
+int addNode( Position * pos, int ply )
+{
+	/* node of pos, a new one (moves not searched yet) if it is not in the book */
+	Position image;
+	uint64_t hash;
+	int sym, n;
+
+	hash = canonicalHash( pos, &sym );
+	if( nodeCount > 0 && ( n = findNode( hash ) ) >= 0 )
+		return n;
+
+	if( nodeCount == nodeCapacity )
+	{
+		nodeCapacity = nodeCapacity ? nodeCapacity * 2 : 4096;
+		if( ( nodes = realloc( nodes, sizeof( BookNode ) * nodeCapacity ) ) == NULL )
+		{
+			printf( "ERROR: Out of memory after %d positions\n", nodeCount );
+			exit( 1 );
+		}
+	}
+
+	n = nodeCount++;
+	symTransformPosition( pos, &image, sym );
+	nodes[ n ].hash = hash;
+	packPosition( &image, nodes[ n ].packed );
+	nodes[ n ].ply = ply;
+	nodes[ n ].moveCount = -1;
+	nodes[ n ].final = 0;
+	nodes[ n ].moves = NULL;
+	insertNode( n );
+
+	return n;
+}
+
+/**********************************************************/
+void addJob( int node, int move, Position * pos )
+{
+	if( jobCount == jobCapacity )
+	{
+		jobCapacity = jobCapacity ? jobCapacity * 2 : 1024;
+		if( ( jobs = realloc( jobs, sizeof( SearchJob ) * jobCapacity ) ) == NULL )
+		{
+			printf( "ERROR: Out of memory\n" );
+			exit( 1 );
+		}
+	}
+
+	jobs[ jobCount ].node = node;
+	jobs[ jobCount ].move = move;
+	memcpy( &jobs[ jobCount ].pos, pos, sizeof( Position ) );
+	jobCount++;
+}
+
+/**********************************************************/
+void prepareNode( int n )
+{
+	/* lists the moves of a new node and queues their searches */
+	Position pos, child;
+	BitBoard legal;
+	Move move;
+	int index, k = 0;
+
+	unpackPosition( nodes[ n ].packed, &pos );
+	legal = legalMoves( &pos, pos.turn );
+
+	if( bbIsEmpty( legal ) && !canMove( &pos, getOtherSide( pos.turn ) ) )
+	{
+		/* the game is over */
+		nodes[ n ].moveCount = 0;
+		nodes[ n ].final = clampScore( pos.turn == WHITE ? evaluate( &pos ) : -evaluate( &pos ) );
+		return;
+	}
+
+	nodes[ n ].moveCount = bbIsEmpty( legal ) ? 1 : bbCount( legal );
+	if( ( nodes[ n ].moves = malloc( sizeof( BookMove ) * nodes[ n ].moveCount ) ) == NULL )
+	{
+		printf( "ERROR: Out of memory\n" );
+		exit( 1 );
+	}
+
+	move.color = pos.turn;
+	if( bbIsEmpty( legal ) )
+	{
+		move.tile[ 0 ] = NULL_MOVE;
+		memcpy( &child, &pos, sizeof( Position ) );
+		doMove( &child, &move );
+		nodes[ n ].moves[ 0 ].move = BOOK_NULL_MOVE;
+		addJob( n, 0, &child );
+		k = 1;
+	}
+
+	for( index = bbFirst( legal ); index >= 0; bbClear( &legal, index ), index = bbFirst( legal ), k++ )
+	{
+		move.tile[ 0 ] = BB_ROW( index );
+		move.tile[ 1 ] = BB_COL( index );
+		memcpy( &child, &pos, sizeof( Position ) );
+		doMove( &child, &move );
+		nodes[ n ].moves[ k ].move = move.tile[ 0 ] * ARRAY_BOARD_SIZE + move.tile[ 1 ];
+		addJob( n, k, &child );
+	}
+
+	for( k = 0; k < nodes[ n ].moveCount; k++ )
+	{
+		nodes[ n ].moves[ k ].score = 0;
+		nodes[ n ].moves[ k ].child = -1;
+		nodes[ n ].moves[ k ].visits = 0;
+	}
+}
+
+/**********************************************************/
+void * searchWorker( void * arg )
+{
+	SearchJob * job;
+	int score;
+
+	setEngine( &engine );
+	while( 1 )
+	{
+		pthread_mutex_lock( &jobLock );
+		job = nextJob < jobCount ? &jobs[ nextJob++ ] : NULL;
+		pthread_mutex_unlock( &jobLock );
+		if( job == NULL )
+			return NULL;
+
+		/* WHITE maximizes in minimax(), the mover is the side not to move in job->pos */
+		score = minimax( job->pos, searchDepth, 0, job->pos.turn == WHITE, TRUE, -EVAL_INF, EVAL_INF );
+		nodes[ job->node ].moves[ job->move ].score = clampScore( job->pos.turn == WHITE ? -score : score );
+	}
+}
+
+/**********************************************************/
+void runJobs( void )
+{
+	pthread_t tid[ MAX_THREADS ];
+	int t;
+
+	nextJob = 0;
+	for( t = 0; t < threads; t++ )
+		pthread_create( &tid[ t ], NULL, searchWorker, NULL );
+	for( t = 0; t < threads; t++ )
+		pthread_join( tid[ t ], NULL );
+
+	jobCount = 0;
+}
+
+/**********************************************************/
+static inline int moveValue( BookNode * node, int k )
+{
+	return node->moves[ k ].child >= 0 ? -value[ node->moves[ k ].child ] : node->moves[ k ].score;
+}
+
+/**********************************************************/
+int backUp( int n )
+{
+	/* negamax value of node n (children first, the graph has no cycles: every move adds a disc or passes once) */
+	BookNode * node = &nodes[ n ];
+	int k, best = -SCORE_LIMIT - 1;
+
+	if( value[ n ] != -SCORE_LIMIT - 1 )
+		return value[ n ];
+
+	if( node->moveCount == 0 )
+		return value[ n ] = node->final;
+
+	for( k = 0; k < node->moveCount; k++ )
+	{
+		if( node->moves[ k ].child >= 0 )
+			backUp( node->moves[ k ].child );
+		if( moveValue( node, k ) > best )
+			best = moveValue( node, k );
+	}
+
+	return value[ n ] = best;
+}
+
+/**********************************************************/
+void computeCosts( void )
+{
+	/* cheapest path from the root to every node: passes over the nodes in the order they
+	   were added (mostly parents first) are repeated until nothing changes */
+	int n, k, c, changed = TRUE;
+	long long step;
+
+	for( n = 0; n < nodeCount; n++ )
+	{
+		cost[ n ] = -1;
+		parentNode[ n ] = parentMove[ n ] = -1;
+	}
+	cost[ 0 ] = 0;
+
+	while( changed )
+	{
+		changed = FALSE;
+		for( n = 0; n < nodeCount; n++ )
+		{
+			if( cost[ n ] < 0 )
+				continue;
+			for( k = 0; k < nodes[ n ].moveCount; k++ )
+			{
+				if( ( c = nodes[ n ].moves[ k ].child ) < 0 )
+					continue;
+				step = cost[ n ] + value[ n ] - moveValue( &nodes[ n ], k ) + plyCost;
+				if( cost[ c ] < 0 || step < cost[ c ] )
+				{
+					cost[ c ] = step;
+					parentNode[ c ] = n;
+					parentMove[ c ] = k;
+					changed = TRUE;
+				}
+			}
+		}
+	}
+}
+
+/**********************************************************/
+int selectDropouts( Dropout * best, int count )
+{
+	/* the count cheapest moves that drop out of the book (sorted by cost) */
+	Dropout d;
+	int n, k, i, found = 0;
+
+	for( n = 0; n < nodeCount; n++ )
+	{
+		if( cost[ n ] < 0 || nodes[ n ].ply >= maxPly )
+			continue;
+		for( k = 0; k < nodes[ n ].moveCount; k++ )
+		{
+			if( nodes[ n ].moves[ k ].child >= 0 )
+				continue;
+			d.cost = cost[ n ] + value[ n ] - nodes[ n ].moves[ k ].score + plyCost;
+			d.node = n;
+			d.move = k;
+			if( found == count && d.cost >= best[ found - 1 ].cost )
+				continue;
+
+			/* insertion into the sorted list */
+			for( i = found < count ? found++ : count - 1; i > 0 && best[ i - 1 ].cost > d.cost; i-- )
+				best[ i ] = best[ i - 1 ];
+			best[ i ] = d;
+		}
+	}
+
+	return found;
+}
+
+/**********************************************************/
+void expand( Dropout * d )
+{
+	/* adds the position after a drop-out move to the book */
+	BookNode * node = &nodes[ d->node ];
+	Position pos;
+	Move move;
+	int n, child;
+
+	unpackPosition( node->packed, &pos );
+	move.color = pos.turn;
+	if( node->moves[ d->move ].move == BOOK_NULL_MOVE )
+		move.tile[ 0 ] = NULL_MOVE;
+	else
+	{
+		move.tile[ 0 ] = node->moves[ d->move ].move / ARRAY_BOARD_SIZE;
+		move.tile[ 1 ] = node->moves[ d->move ].move % ARRAY_BOARD_SIZE;
+	}
+	doMove( &pos, &move );
+
+	child = addNode( &pos, node->ply + 1 );		//may move nodes
+	node = &nodes[ d->node ];
+	node->moves[ d->move ].child = child;
+	if( nodes[ child ].moveCount < 0 && nodes[ child ].moves == NULL )
+		prepareNode( child );
+
+	/* count the expansion on the path from the root */
+	node->moves[ d->move ].visits++;
+	for( n = d->node; parentNode[ n ] >= 0; n = parentNode[ n ] )
+		nodes[ parentNode[ n ] ].moves[ parentMove[ n ] ].visits++;
+}
+
+/**********************************************************/
+int saveState( char * fileName, int rounds )
+{
+	char tmp[ 1024 ];
+	int header[ 5 ] = { STATE_FILE_MAGIC, STATE_FILE_VERSION, HEX_BOARD_RADIUS, nodeCount, rounds };
+	FILE * f;
+	int n, ok;
+
+	snprintf( tmp, sizeof( tmp ), "%s.tmp", fileName );
+	if( ( f = fopen( tmp, "wb" ) ) == NULL )
+	{
+		printf( "ERROR: Cannot create %s\n", tmp );
+		return -1;
+	}
+
+	ok = fwrite( header, sizeof( int ), 5, f ) == 5;
+	for( n = 0; ok && n < nodeCount; n++ )
+	{
+		ok = fwrite( &nodes[ n ].hash, sizeof( uint64_t ), 1, f ) == 1
+			&& fwrite( nodes[ n ].packed, 1, PACKED_POSITION_BYTES, f ) == PACKED_POSITION_BYTES
+			&& fwrite( &nodes[ n ].ply, sizeof( short ), 1, f ) == 1
+			&& fwrite( &nodes[ n ].moveCount, sizeof( short ), 1, f ) == 1
+			&& fwrite( &nodes[ n ].final, sizeof( short ), 1, f ) == 1;
+		if( ok && nodes[ n ].moveCount > 0 )
+			ok = fwrite( nodes[ n ].moves, sizeof( BookMove ), nodes[ n ].moveCount, f ) == nodes[ n ].moveCount;
+	}
+
+	if( fclose( f ) != 0 || !ok || rename( tmp, fileName ) != 0 )
+	{
+		printf( "ERROR: Cannot write %s\n", fileName );
+		return -1;
+	}
+
+	return 0;
+}
+
+/**********************************************************/
+int loadState( char * fileName, int * rounds )
+{
+	int header[ 5 ], n, ok;
+	FILE * f;
+
+	if( ( f = fopen( fileName, "rb" ) ) == NULL )
+		return 0;		//nothing to resume
+
+	if( fread( header, sizeof( int ), 5, f ) != 5 || header[ 0 ] != STATE_FILE_MAGIC || header[ 1 ] != STATE_FILE_VERSION
+		|| header[ 2 ] != HEX_BOARD_RADIUS || header[ 3 ] < 1 )
+	{
+		printf( "ERROR: %s is not a book builder state for this board\n", fileName );
+		fclose( f );
+		return -1;
+	}
+
+	nodeCapacity = header[ 3 ];
+	if( ( nodes = malloc( sizeof( BookNode ) * nodeCapacity ) ) == NULL )
+	{
+		printf( "ERROR: Out of memory\n" );
+		exit( 1 );
+	}
+
+	for( n = 0, ok = TRUE; ok && n < header[ 3 ]; n++ )
+	{
+		ok = fread( &nodes[ n ].hash, sizeof( uint64_t ), 1, f ) == 1
+			&& fread( nodes[ n ].packed, 1, PACKED_POSITION_BYTES, f ) == PACKED_POSITION_BYTES
+			&& fread( &nodes[ n ].ply, sizeof( short ), 1, f ) == 1
+			&& fread( &nodes[ n ].moveCount, sizeof( short ), 1, f ) == 1
+			&& fread( &nodes[ n ].final, sizeof( short ), 1, f ) == 1;
+		nodes[ n ].moves = NULL;
+		if( ok && nodes[ n ].moveCount > 0 )
+			ok = ( nodes[ n ].moves = malloc( sizeof( BookMove ) * nodes[ n ].moveCount ) ) != NULL
+				&& fread( nodes[ n ].moves, sizeof( BookMove ), nodes[ n ].moveCount, f ) == nodes[ n ].moveCount;
+		nodeCount = n + 1;
+		if( ok )
+			insertNode( n );
+	}
+	fclose( f );
+
+	if( !ok )
+	{
+		printf( "ERROR: %s is truncated\n", fileName );
+		return -1;
+	}
+
+	*rounds = header[ 4 ];
+	return 0;
+}
+
+/**********************************************************/
+int saveBook( char * fileName )
+{
+	BookEntry * entries;
+	uint64_t count = 0;
+	int n, k, result;
+
+	for( n = 0; n < nodeCount; n++ )
+		count += nodes[ n ].moveCount > 0 ? nodes[ n ].moveCount : 0;
+
+	if( ( entries = malloc( sizeof( BookEntry ) * ( count ? count : 1 ) ) ) == NULL )
+	{
+		printf( "ERROR: Out of memory\n" );
+		return -1;
+	}
+
+	for( count = 0, n = 0; n < nodeCount; n++ )
+		for( k = 0; k < nodes[ n ].moveCount; k++, count++ )
+		{
+			entries[ count ].hash = nodes[ n ].hash;
+			entries[ count ].move = nodes[ n ].moves[ k ].move;
+			entries[ count ].score = moveValue( &nodes[ n ], k );
+			entries[ count ].visits = nodes[ n ].moves[ k ].visits;
+		}
+
+	result = writeBook( fileName, entries, count );
+	free( entries );
+	return result;
+}
+
+/**********************************************************/
+int main( int argc, char ** argv )
+{
+	char * bookFile = "book.bin";
+	char * stateFile = "book.state";
+	char * weightsFile = NULL;
+	int expansions = 1000, batch = 0, checkpoint = 10;
+	int c, n, k, rounds = 0, added, found;
+	Dropout * best;
+	Position pos;
+	time_t start;
+
+	opterr = 0;
+	while( ( c = getopt( argc, argv, "o:s:n:d:l:p:t:b:k:e:w:h" ) ) != -1 )
+		switch( c )
+		{
+			case 'h':
+				printf( "[-o book_output] [-s state_file] [-n positions_to_add] [-d search_depth] [-l max_ply] [-p ply_cost] [-t threads] [-b positions_per_round] [-k rounds_per_checkpoint] [-e classic|pattern|nnue] [-w weights_file]\n" );
+				return 0;
+			case 'o':
+				bookFile = optarg;
+				break;
+			case 's':
+				stateFile = optarg;
+				break;
+			case 'n':
+				expansions = atoi( optarg );
+				break;
+			case 'd':
+				searchDepth = atoi( optarg );
+				break;
+			case 'l':
+				maxPly = atoi( optarg );
+				break;
+			case 'p':
+				plyCost = atoi( optarg );
+				break;
+			case 't':
+				threads = atoi( optarg );
+				if( threads < 1 ) threads = 1;
+				if( threads > MAX_THREADS ) threads = MAX_THREADS;
+				break;
+			case 'b':
+				batch = atoi( optarg );
+				break;
+			case 'k':
+				checkpoint = atoi( optarg );
+				if( checkpoint < 1 ) checkpoint = 1;
+				break;
+			case 'e':
+				if( strcmp( optarg, "pattern" ) == 0 )
+					evaluator = EVAL_PATTERN;
+				else if( strcmp( optarg, "nnue" ) == 0 )
+					evaluator = EVAL_NNUE;
+				else if( strcmp( optarg, "classic" ) == 0 )
+					evaluator = EVAL_CLASSIC;
+				else
+				{
+					printf( "Unknown evaluation %s\n", optarg );
+					return 1;
+				}
+				break;
+			case 'w':
+				weightsFile = optarg;
+				break;
+			case '?':
+				if( isprint( optopt ) )
+					printf( "Unknown option or missing argument -%c\n", ( char ) optopt );
+				else
+					printf( "Unknown option character -%c\n", ( char ) optopt );
+				return 1;
+			default:
+				return 1;
+		}
+
+	if( evaluator == EVAL_NNUE && weightsFile == NULL )
+	{
+		printf( "The nnue evaluation needs a network (-w network_file)\n" );
+		return 1;
+	}
+	if( weightsFile != NULL )
+	{
+		if( evaluator == EVAL_NNUE && loadNetwork( weightsFile ) < 0 )
+			return 1;
+		if( evaluator == EVAL_PATTERN && loadPatternWeights( weightsFile ) < 0 )
+			return 1;
+		if( evaluator == EVAL_CLASSIC && loadEvalWeights( weightsFile ) < 0 )
+			return 1;
+	}
+	if( batch < 1 )
+		batch = 2 * threads;
+
+	initPosition( &pos );		//also sets up the tables the threads share
+	initSymmetry();
+	if( initEvalCache( EVAL_CACHE_MB * threads ) < 0 )
+		return 1;
+	getEngine( &engine );
+
+	if( loadState( stateFile, &rounds ) < 0 )
+		return 1;
+	if( nodeCount > 0 )
+		printf( "Resuming %s: %d positions after %d rounds\n", stateFile, nodeCount, rounds );
+	else
+	{
+		prepareNode( addNode( &pos, 0 ) );
+		runJobs();
+	}
+
+	best = malloc( sizeof( Dropout ) * batch );
+	start = time( NULL );
+
+	for( added = 0; added < expansions; added += found )
+	{
+		value = malloc( sizeof( int ) * nodeCount );
+		cost = malloc( sizeof( long long ) * nodeCount );
+		parentNode = malloc( sizeof( int ) * nodeCount );
+		parentMove = malloc( sizeof( int ) * nodeCount );
+		if( value == NULL || cost == NULL || parentNode == NULL || parentMove == NULL )
+		{
+			printf( "ERROR: Out of memory after %d positions\n", nodeCount );
+			return 1;
+		}
+
+		for( n = 0; n < nodeCount; n++ )
+			value[ n ] = -SCORE_LIMIT - 1;
+		backUp( 0 );
+		computeCosts();
+
+		found = selectDropouts( best, expansions - added < batch ? expansions - added : batch );
+		for( k = 0; k < found; k++ )
+			expand( &best[ k ] );		//the queued searches of the new positions
+		runJobs();
+
+		free( value );
+		free( cost );
+		free( parentNode );
+		free( parentMove );
+
+		if( found == 0 )
+		{
+			printf( "Nothing left to add within %d plies\n", maxPly );
+			break;
+		}
+
+		rounds++;
+		printf( "Round %d: %d positions, %d added in %ld s\n", rounds, nodeCount, added + found, ( long ) ( time( NULL ) - start ) );
+		if( rounds % checkpoint == 0 && ( saveState( stateFile, rounds ) < 0 || saveBook( bookFile ) < 0 ) )
+			return 1;
+	}
+
+	if( saveState( stateFile, rounds ) < 0 || saveBook( bookFile ) < 0 )
+		return 1;
+
+	printf( "Book %s: %d positions\n", bookFile, nodeCount );
+	return 0;
+}
@@ -3,6 +3,8 @@
 #include "move.h"
 #include "comm.h"
 #include "minimax.h"
+#include "book.h"
+#include "tt.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -24,6 +26,13 @@ char * agentName = "SAMATA";		//default name.. change it! keep in mind MAX_NAME_
 char * ip = "127.0.0.1";	// default ip (local machine)
 
 char * agent = "alphabeta"; 	// agent algorithm	
+
+int evalCacheMB = EVAL_CACHE_MB;	// evaluation cache size (0: no cache)
+
+char * weightsFile = NULL;		// evaluation weights (classic: tuner output, pattern: pattern tables, nnue: network)
+char * bookFile = NULL;			// opening book (book.h), mapped at startup
+int ttMB = -1;					// transposition table size (0: no table), not given: off, TT_MB with a file
+char * ttFile = NULL;			// file that keeps the transposition table across games (tt.h)
 /**********************************************************/
 
 
@@ -32,12 +41,43 @@ int main( int argc, char ** argv )
 	int c;
 	opterr = 0;
 
-	while( ( c = getopt ( argc, argv, "i:p:hrma" ) ) != -1 )
+	while( ( c = getopt ( argc, argv, "i:p:hrmae:w:c:Fb:t:T:" ) ) != -1 )
 		switch( c )
 		{
 			case 'h':
-				printf( "[-i ip] [-p port] [-r random] [-m minimax] [-a alphabeta pruning (minimax)] \n" );
+				printf( "[-i ip] [-p port] [-r random] [-m minimax] [-a alphabeta pruning (minimax)] [-e classic|pattern|nnue (evaluation)] [-w weights_file] [-c eval_cache_MB] [-F (no forward pruning)] [-b opening_book] [-t hash_MB] [-T hash_file]\n" );
 				return 0;
+			case 'e':
+				if( strcmp( optarg, "pattern" ) == 0 )
+					evaluator = EVAL_PATTERN;
+				else if( strcmp( optarg, "nnue" ) == 0 )
+					evaluator = EVAL_NNUE;
+				else if( strcmp( optarg, "classic" ) == 0 )
+					evaluator = EVAL_CLASSIC;
+				else
+				{
+					printf( "Unknown evaluation %s\n", optarg );
+					return 1;
+				}
+				break;
+			case 'w':
+				weightsFile = optarg;
+				break;
+			case 'c':
+				evalCacheMB = atoi( optarg );
+				break;
+			case 'F':
+				forwardPruning = FALSE;
+				break;
+			case 'b':
+				bookFile = optarg;
+				break;
+			case 't':
+				ttMB = atoi( optarg );
+				break;
+			case 'T':
+				ttFile = optarg;
+				break;
 			case 'm': 
 				agent = "minimax";
 				agentName = "minimax!";
@@ -57,7 +97,7 @@ int main( int argc, char ** argv )
 				port = optarg;
 				break;
 			case '?':
-				if( optopt == 'i' || optopt == 'p' )
+				if( optopt == 'i' || optopt == 'p' || optopt == 'e' || optopt == 'w' || optopt == 'c' || optopt == 'b' || optopt == 't' || optopt == 'T' )
 					printf( "Option -%c requires an argument.\n", ( char ) optopt );
 				else if( isprint( optopt ) )
 					printf( "Unknown option -%c\n", ( char ) optopt );
@@ -68,6 +108,34 @@ int main( int argc, char ** argv )
 			return 1;
 		}
 
+	if( ttMB < 0 )
+		ttMB = ( ttFile != NULL ) ? TT_MB : 0;
+
+	if( evaluator == EVAL_NNUE && weightsFile == NULL )
+	{
+		printf( "The nnue evaluation needs a network (-w network_file)\n" );
+		return 1;
+	}
+
+	if( weightsFile != NULL )
+	{
+		if( evaluator == EVAL_NNUE && loadNetwork( weightsFile ) < 0 )
+			return 1;
+		if( evaluator == EVAL_PATTERN && loadPatternWeights( weightsFile ) < 0 )
+			return 1;
+		if( evaluator == EVAL_CLASSIC && loadEvalWeights( weightsFile ) < 0 )
+			return 1;
+	}
+
+	if( initEvalCache( evalCacheMB ) < 0 )
+		return 1;
+
+	if( bookFile != NULL && openBook( bookFile ) < 0 )
+		return 1;
+
+	if( initTT( ttMB, ttFile ) < 0 )
+		return 1;
+
 	connectToTarget( port, ip, &mySocket );
 
 /**********************************************************
@@ -92,6 +160,11 @@ int main( int argc, char ** argv )
 				printPosition( &gamePosition );
 				break;
 
+			case NM_NEW_POSITION_PACKED:	//same, packed to PACKED_POSITION_BYTES
+				getPackedPosition( &gamePosition, mySocket );
+				printPosition( &gamePosition );
+				break;
+
 			case NM_COLOR_W:			//server informs us that we have WHITE color
 				myColor = WHITE;
 				break;
@@ -153,6 +226,23 @@ int main( int argc, char ** argv )
 				printPosition( &gamePosition );
 				break;
 
+			case NM_SHM_TRANSPORT:		//server moves the connection to shared memory (same host)
+				if( acceptSharedMemory( mySocket ) < 0 )
+				{
+					close( mySocket );
+					return 1;
+				}
+				break;
+
+			case NM_BOARD_RADIUS:		//server tells us the size of the board
+				if( recvMsg( mySocket ) != HEX_BOARD_RADIUS )
+				{
+					printf( "ERROR: The server plays on another board radius, this client is built for radius %d (make RADIUS=...)\n", HEX_BOARD_RADIUS );
+					close( mySocket );
+					return 1;
+				}
+				break;
+
 			case NM_QUIT:			//server wants us to quit...we shall obey
 				close( mySocket );
 				return 0;
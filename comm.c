@@ -1,10 +1,419 @@
 #include "comm.h"
+#include "pack.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <netinet/tcp.h>
+
+#define RING_BYTES 65536		//bytes of each ring (a power of two)
+#define RING_SPIN 2000			//polls of a ring before sleeping on its futex
+#define MAX_CHANNELS 1024		//sockets below this can switch to shared memory
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define RING_PAUSE() __builtin_ia32_pause()
+#else
+#define RING_PAUSE()
+#endif
+
+/**********************************************************/
+/* one direction of a shared memory connection: a single producer, single consumer byte ring */
+typedef struct
+{
+	uint32_t head;				//bytes written so far (by the producer), also the futex the consumer sleeps on
+	uint32_t readerWaiting;		//TRUE while the consumer sleeps
+	char pad1[ 56 ];			//head and tail on their own cache lines
+	uint32_t tail;				//bytes read so far (by the consumer), also the futex the producer sleeps on
+	uint32_t writerWaiting;		//TRUE while the producer sleeps
+	char pad2[ 56 ];
+	unsigned char data[ RING_BYTES ];
+} Ring;
+
+typedef struct
+{
+	Ring * in, * out;
+	void * base;				//the mapping: ring 0 server to client, ring 1 client to server
+	char name[ 64 ];			//server: the segment name until the client answers over the rings, then ""
+} Channel;
 
 /**********************************************************/
 char * port = DEFAULT_PORT;		// default port
+int tcpNoDelay = TRUE;			// TCP_NODELAY on connected sockets
+
+static Channel * channels[ MAX_CHANNELS ];	// shared memory of a socket, NULL: TCP
+static int ringSpin = -1;			// polls before sleeping: RING_SPIN, 0 on one CPU (the peer could not run meanwhile), -1 not known yet
+
+/**********************************************************/
+static void futexWait( uint32_t * word, uint32_t value )
+{
+	struct timespec timeout = { 1, 0 };		//wakes up now and then to see if the peer is still there
+	syscall( SYS_futex, word, FUTEX_WAIT, value, &timeout, NULL, 0 );
+}
+
+/**********************************************************/
+static void futexWake( uint32_t * word )
+{
+	syscall( SYS_futex, word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0 );
+}
+
+/**********************************************************/
+static int ringWait( uint32_t * word, uint32_t seen, uint32_t * waiting, int mySocket )
+{
+	/* waits until *word moves on from seen, -1 if the peer closed the socket meanwhile */
+	char byte;
+	int k;
+
+	for( k = 0; k < ringSpin; k++ )
+	{
+		if( __atomic_load_n( word, __ATOMIC_ACQUIRE ) != seen )
+			return 0;
+		RING_PAUSE();
+	}
+
+	while( 1 )
+	{
+		/* the flag is set before the last look, the peer sets the word before it looks at the flag */
+		__atomic_store_n( waiting, TRUE, __ATOMIC_SEQ_CST );
+		if( __atomic_load_n( word, __ATOMIC_SEQ_CST ) != seen )
+			break;
+		futexWait( word, seen );
+		if( __atomic_load_n( word, __ATOMIC_ACQUIRE ) != seen )
+			break;
+		if( recv( mySocket, &byte, 1, MSG_PEEK | MSG_DONTWAIT ) == 0 )
+		{
+			__atomic_store_n( waiting, FALSE, __ATOMIC_RELAXED );
+			return -1;
+		}
+	}
+
+	__atomic_store_n( waiting, FALSE, __ATOMIC_RELAXED );
+	return 0;
+}
+
+/**********************************************************/
+static void ringPublish( uint32_t * word, uint32_t value, uint32_t * waiting )
+{
+	/* moves head or tail on and wakes the peer if it sleeps on it */
+	__atomic_store_n( word, value, __ATOMIC_SEQ_CST );
+	if( __atomic_load_n( waiting, __ATOMIC_SEQ_CST ) )
+		futexWake( word );
+}
+
+/**********************************************************/
+static int ringRead( Channel * channel, int mySocket, unsigned char * p, int length )
+{
+	Ring * ring = channel->in;
+	uint32_t tail = ring->tail, head, n, first;
+
+	while( length > 0 )
+	{
+		head = __atomic_load_n( &ring->head, __ATOMIC_ACQUIRE );
+		if( head == tail )
+		{
+			if( ringWait( &ring->head, tail, &ring->readerWaiting, mySocket ) < 0 )
+				return -1;
+			continue;
+		}
+
+		n = head - tail < ( uint32_t ) length ? head - tail : ( uint32_t ) length;
+		first = RING_BYTES - tail % RING_BYTES < n ? RING_BYTES - tail % RING_BYTES : n;
+		memcpy( p, ring->data + tail % RING_BYTES, first );
+		memcpy( p + first, ring->data, n - first );
+		p += n;
+		length -= n;
+		tail += n;
+		ringPublish( &ring->tail, tail, &ring->writerWaiting );
+	}
+
+	return 0;
+}
+
+/**********************************************************/
+static int ringWrite( Channel * channel, int mySocket, struct iovec * iov, int count )
+{
+	Ring * ring = channel->out;
+	uint32_t head = ring->head, tail, n, first;
+	unsigned char * p;
+	size_t length;
+
+	for( ; count > 0; iov++, count-- )
+		for( p = iov->iov_base, length = iov->iov_len; length > 0; )
+		{
+			tail = __atomic_load_n( &ring->tail, __ATOMIC_ACQUIRE );
+			if( head - tail == RING_BYTES )
+			{
+				ringPublish( &ring->head, head, &ring->readerWaiting );		//full: let the reader have it first
+				if( ringWait( &ring->tail, tail, &ring->writerWaiting, mySocket ) < 0 )
+					return -1;
+				continue;
+			}
+
+			n = RING_BYTES - ( head - tail ) < length ? RING_BYTES - ( head - tail ) : ( uint32_t ) length;
+			first = RING_BYTES - head % RING_BYTES < n ? RING_BYTES - head % RING_BYTES : n;
+			memcpy( ring->data + head % RING_BYTES, p, first );
+			memcpy( ring->data, p + first, n - first );
+			p += n;
+			length -= n;
+			head += n;
+		}
+
+	ringPublish( &ring->head, head, &ring->readerWaiting );		//the whole message at once
+	return 0;
+}
+
+/**********************************************************/
+static Channel * channelOf( int mySocket )
+{
+	return mySocket >= 0 && mySocket < MAX_CHANNELS ? channels[ mySocket ] : NULL;
+}
+
+/**********************************************************/
+static void releaseName( Channel * channel )
+{
+	/* the server removes its segment name once the client has mapped it or is gone */
+	if( channel->name[ 0 ] == '\0' )
+		return;
+	shm_unlink( channel->name );
+	channel->name[ 0 ] = '\0';
+}
+
+/**********************************************************/
+void releaseSharedMemory( void )
+{
+	/* names of clients that have not answered yet (at exit, and safe in a signal handler) */
+	int k;
+
+	for( k = 0; k < MAX_CHANNELS; k++ )
+		if( channels[ k ] != NULL )
+			releaseName( channels[ k ] );
+}
+
+/**********************************************************/
+static void detachChannel( int mySocket )
+{
+	/* a new socket got the number of a closed one: its rings are not ours any more */
+	Channel * channel = channelOf( mySocket );
+
+	if( channel == NULL )
+		return;
+
+	releaseName( channel );
+	munmap( channel->base, 2 * sizeof( Ring ) );
+	free( channel );
+	channels[ mySocket ] = NULL;
+}
+
+/**********************************************************/
+static int attachChannel( int mySocket, void * base, char * name )
+{
+	/* name: the segment name on the server, NULL on the client */
+	Channel * channel = malloc( sizeof( Channel ) );
+	Ring * rings = base;
+
+	if( channel == NULL )
+		return -1;
+
+	if( ringSpin < 0 )
+		ringSpin = sysconf( _SC_NPROCESSORS_ONLN ) > 1 ? RING_SPIN : 0;
+
+	channel->base = base;
+	channel->in = name != NULL ? &rings[ 1 ] : &rings[ 0 ];
+	channel->out = name != NULL ? &rings[ 0 ] : &rings[ 1 ];
+	snprintf( channel->name, sizeof( channel->name ), "%s", name != NULL ? name : "" );
+	channels[ mySocket ] = channel;
+	return 0;
+}
+
+/**********************************************************/
+int readFully( int mySocket, void * buffer, int length )
+{
+	/* recv() until length bytes are in (a message may arrive in pieces) */
+	Channel * channel = channelOf( mySocket );
+	char * p = buffer;
+	ssize_t n;
+	int result;
+
+	if( channel != NULL )
+	{
+		result = ringRead( channel, mySocket, buffer, length );
+		releaseName( channel );		//the client has answered over the rings, or left
+		return result;
+	}
+
+	while( length > 0 )
+	{
+		n = recv( mySocket, p, length, 0 );
+		if( n < 0 && errno == EINTR )
+			continue;
+		if( n <= 0 )
+			return -1;
+		p += n;
+		length -= n;
+	}
+
+	return 0;
+}
+
+/**********************************************************/
+static int writeFully( int mySocket, struct iovec * iov, int count )
+{
+	/* writev() until every buffer is out, the buffers go in one call (one segment without Nagle) */
+	Channel * channel = channelOf( mySocket );
+	ssize_t n;
+
+	if( channel != NULL )
+	{
+		if( ringWrite( channel, mySocket, iov, count ) < 0 )
+		{
+			releaseName( channel );		//the client left
+			return -1;
+		}
+		return 0;
+	}
+
+	while( count > 0 )
+	{
+		n = writev( mySocket, iov, count );
+		if( n < 0 && errno == EINTR )
+			continue;
+		if( n <= 0 )
+			return -1;
+
+		while( count > 0 && n >= ( ssize_t ) iov->iov_len )
+		{
+			n -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if( count > 0 )
+		{
+			iov->iov_base = ( char * ) iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+
+	return 0;
+}
+
+/**********************************************************/
+static int sendBytes( int mySocket, int msg, void * payload, int length )
+{
+	/* an optional message code (msg < 0: none) and its payload in one write */
+	struct iovec iov[ 2 ];
+	char msgCode = ( char ) msg;
+	int count = 0;
+
+	if( msg >= 0 )
+	{
+		iov[ count ].iov_base = &msgCode;
+		iov[ count++ ].iov_len = 1;
+	}
+	if( length > 0 )
+	{
+		iov[ count ].iov_base = payload;
+		iov[ count++ ].iov_len = length;
+	}
+
+	if( writeFully( mySocket, iov, count ) < 0 )
+	{
+		printf( "ERROR: Network problem\n" );
+		return -1;
+	}
+
+	return 0;
+}
+
+/**********************************************************/
+int offerSharedMemory( int mySocket )
+{
+	static int segments = 0;
+	unsigned char name[ 1 + 64 ];
+	void * base;
+	int fd;
+
+	if( mySocket < 0 || mySocket >= MAX_CHANNELS )
+	{
+		printf( "ERROR: Socket %d cannot use shared memory, it stays on TCP\n", mySocket );
+		return -1;
+	}
+
+	name[ 0 ] = snprintf( ( char * ) name + 1, sizeof( name ) - 1, "/hexthello-%d-%d", ( int ) getpid(), segments++ );
+
+	if( ( fd = shm_open( ( char * ) name + 1, O_CREAT | O_EXCL | O_RDWR, 0600 ) ) < 0 )
+	{
+		printf( "ERROR: Cannot create shared memory %s, the connection stays on TCP\n", name + 1 );
+		return -1;
+	}
+	if( ftruncate( fd, 2 * sizeof( Ring ) ) < 0
+		|| ( base = mmap( NULL, 2 * sizeof( Ring ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 ) ) == MAP_FAILED )
+	{
+		printf( "ERROR: Cannot map shared memory %s, the connection stays on TCP\n", name + 1 );
+		close( fd );
+		shm_unlink( ( char * ) name + 1 );
+		return -1;
+	}
+	close( fd );
+
+	if( segments == 1 )
+		atexit( releaseSharedMemory );
+
+	/* the last message over TCP; the name goes with the client's first message over the rings (see releaseName()) */
+	if( sendBytes( mySocket, NM_SHM_TRANSPORT, name, 1 + name[ 0 ] ) < 0 || attachChannel( mySocket, base, ( char * ) name + 1 ) < 0 )
+	{
+		munmap( base, 2 * sizeof( Ring ) );
+		shm_unlink( ( char * ) name + 1 );
+		return -1;
+	}
+
+	return 0;
+}
+
+/**********************************************************/
+int acceptSharedMemory( int mySocket )
+{
+	unsigned char size;
+	char name[ 256 ];
+	void * base;
+	int fd;
+
+	if( readFully( mySocket, &size, 1 ) < 0 || readFully( mySocket, name, size ) < 0 )
+	{
+		printf( "ERROR: Network problem\n" );
+		return -1;
+	}
+	name[ size ] = '\0';
+
+	if( mySocket >= MAX_CHANNELS || ( fd = shm_open( name, O_RDWR, 0 ) ) < 0 )
+	{
+		printf( "ERROR: Cannot open shared memory %s\n", name );
+		shm_unlink( name );
+		return -1;
+	}
+	base = mmap( NULL, 2 * sizeof( Ring ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+	close( fd );
+	shm_unlink( name );
+	if( base == MAP_FAILED || attachChannel( mySocket, base, NULL ) < 0 )
+	{
+		printf( "ERROR: Cannot map shared memory %s\n", name );
+		return -1;
+	}
+
+	return 0;
+}
+
+/**********************************************************/
+void setNoDelay( int mySocket )
+{
+	int optval = tcpNoDelay;
+	setsockopt( mySocket, IPPROTO_TCP, TCP_NODELAY, &optval, sizeof optval );
+}
 
 /**********************************************************/
 void listenToSocket( char * port, int * mySocket )
@@ -67,6 +476,8 @@ int acceptConnection( int mySocket )
 
 	}
 
+	setNoDelay( connectedSocket );
+	detachChannel( connectedSocket );
 	return connectedSocket;
 }
 
@@ -93,23 +504,15 @@ void connectToTarget( char * port, char * ip, int * mySocket )
 		sleep( 1 );
 	}
 
+	setNoDelay( *mySocket );
+	detachChannel( *mySocket );
+
 }
 
 /**********************************************************/
 int sendMsg( int msg, int mySocket )
 {
-	char msgCode;
-
-	msgCode = ( char ) msg;
-
-	if( send( mySocket, &msgCode, 1, 0 ) != 1 )
-	{
-		printf( "ERROR: Network problem\n" );
-		return -1;
-	}
-
-	return 0;
-
+	return sendBytes( mySocket, msg, NULL, 0 );
 }
 
 /**********************************************************/
@@ -117,7 +520,7 @@ int recvMsg( int socket )
 {
 	char msg;
 
-	if( recv( socket, &msg, 1, 0 ) != 1 )
+	if( readFully( socket, &msg, 1 ) < 0 )
 	{
 		printf( "ERROR: Network problem\n" );
 		exit( 1 );
@@ -130,20 +533,19 @@ int recvMsg( int socket )
 
 /**********************************************************/
 int sendMove( Move * moveToSend, int mySocket )
+{
+	return sendMsgAndMove( -1, moveToSend, mySocket );
+}
+
+/**********************************************************/
+int sendMsgAndMove( int msg, Move * moveToSend, int mySocket )
 {
 	char buffer[ 2 ];
 
 	buffer[ 0 ] = moveToSend->tile[ 0 ];
 	buffer[ 1 ] = moveToSend->tile[ 1 ];
 
-	if( send( mySocket, buffer, 2, 0 ) != 2 )
-	{
-		printf( "ERROR: Network problem\n" );
-		return -1;
-	}
-
-	return 0;
-
+	return sendBytes( mySocket, msg, buffer, 2 );
 }
 
 /**********************************************************/
@@ -151,7 +553,7 @@ int getMove( Move * moveToGet, int mySocket )
 {
 	char buffer[ 2 ];
 
-	if( recv( mySocket, buffer, 2, 0 ) != 2 )
+	if( readFully( mySocket, buffer, 2 ) < 0 )
 	{
 		printf( "ERROR: Network problem\n" );
 		return -1;
@@ -170,22 +572,11 @@ int getMove( Move * moveToGet, int mySocket )
 void sendName( char textToSend[ MAX_NAME_LENGTH + 1 ], int mySocket )
 {
 	int size;
-	char size_char;
 
 	size = strlen( textToSend );
-	size_char = ( char ) size;
 
-	if( send( mySocket, &size_char, 1, 0 ) != 1 )
-	{
-		printf( "ERROR: Network problem\n" );
-		exit( 1 );
-	}
-
-	if( send( mySocket, textToSend, size , 0 ) != size )
-	{
-		printf( "ERROR: Network problem\n" );
+	if( sendBytes( mySocket, size, textToSend, size ) < 0 )		//the length, then the name
 		exit( 1 );
-	}
 
 }
 
@@ -195,10 +586,10 @@ int getName( char textToGet[ MAX_NAME_LENGTH + 1 ], int mySocket )
 {
 
 	int size;
-	char size_char;
+	unsigned char size_char;
 	char dummy[256];
 
-	if( recv( mySocket, &size_char, 1, 0 ) != 1 )
+	if( readFully( mySocket, &size_char, 1 ) < 0 )
 	{
 		printf( "ERROR: Network problem\n" );
 		return -1;
@@ -206,7 +597,7 @@ int getName( char textToGet[ MAX_NAME_LENGTH + 1 ], int mySocket )
 
 	size = ( int ) size_char;
 
-	if( recv( mySocket, dummy, size, 0 ) != size )
+	if( readFully( mySocket, dummy, size ) < 0 )
 	{
 		printf( "ERROR: Network problem\n" );
 		return -1;
@@ -225,6 +616,12 @@ int getName( char textToGet[ MAX_NAME_LENGTH + 1 ], int mySocket )
 
 /**********************************************************/
 int sendPosition( Position * posToSend, int mySocket )
+{
+	return sendMsgAndPosition( -1, posToSend, mySocket );
+}
+
+/**********************************************************/
+int sendMsgAndPosition( int msg, Position * posToSend, int mySocket )
 {
 	char buffer[ ARRAY_BOARD_SIZE * ARRAY_BOARD_SIZE + 2 + 1 ];
 	int i, j;
@@ -241,13 +638,7 @@ int sendPosition( Position * posToSend, int mySocket )
 	//turn
 	buffer[ ARRAY_BOARD_SIZE * ARRAY_BOARD_SIZE + 2 ] = posToSend->turn;
 
-	if( send( mySocket, buffer, ARRAY_BOARD_SIZE * ARRAY_BOARD_SIZE + 2 + 1, 0 ) != ARRAY_BOARD_SIZE * ARRAY_BOARD_SIZE + 2 + 1 )
-	{
-		printf( "ERROR: Network problem\n" );
-		return -1;
-	}
-
-	return 0;
+	return sendBytes( mySocket, msg, buffer, ARRAY_BOARD_SIZE * ARRAY_BOARD_SIZE + 2 + 1 );
 
 }
 
@@ -257,7 +648,7 @@ void getPosition( Position * posToGet, int mySocket )
 	char buffer[ ARRAY_BOARD_SIZE * ARRAY_BOARD_SIZE + 2 + 1 ];
 	int i, j;
 
-	if( recv( mySocket, buffer, ARRAY_BOARD_SIZE * ARRAY_BOARD_SIZE + 2 + 1, 0 ) != ARRAY_BOARD_SIZE * ARRAY_BOARD_SIZE + 2 + 1 )
+	if( readFully( mySocket, buffer, ARRAY_BOARD_SIZE * ARRAY_BOARD_SIZE + 2 + 1 ) < 0 )
 	{
 		printf( "ERROR: Network problem\n" );
 		exit( 1 );
@@ -274,10 +665,37 @@ void getPosition( Position * posToGet, int mySocket )
 
 	//turn
 	posToGet->turn = buffer[ ARRAY_BOARD_SIZE * ARRAY_BOARD_SIZE + 2 ];
+
+	//bitboards and empty regions are not sent
+	syncPosition( posToGet );
+}
+
+/**********************************************************/
+int sendPackedPosition( Position * posToSend, int mySocket )
+{
+	return sendMsgAndPackedPosition( -1, posToSend, mySocket );
 }
 
+/**********************************************************/
+int sendMsgAndPackedPosition( int msg, Position * posToSend, int mySocket )
+{
+	unsigned char buffer[ PACKED_POSITION_BYTES ];
 
+	packPosition( posToSend, buffer );
 
+	return sendBytes( mySocket, msg, buffer, PACKED_POSITION_BYTES );
+}
 
+/**********************************************************/
+void getPackedPosition( Position * posToGet, int mySocket )
+{
+	unsigned char buffer[ PACKED_POSITION_BYTES ];
 
+	if( readFully( mySocket, buffer, PACKED_POSITION_BYTES ) < 0 )
+	{
+		printf( "ERROR: Network problem\n" );
+		exit( 1 );
+	}
 
+	unpackPosition( buffer, posToGet );		//also rebuilds the score and the bitboards
+}
@@ -20,8 +20,21 @@
 #define NM_PREPARE_TO_RECEIVE_MOVE 105
 #define NM_REQUEST_NAME 106
 #define NM_QUIT 107
+#define NM_BOARD_RADIUS 108		//followed by one byte: the radius the server plays on
+#define NM_NEW_POSITION_PACKED 109	//like NM_NEW_POSITION, followed by a packed position (see pack.h)
+#define NM_SHM_TRANSPORT 110		//followed by a length byte and the name of a shared memory segment, the connection goes on there
+/*
+Shared memory transport (server -m, same host only): after NM_SHM_TRANSPORT both
+ends move every message of the connection to two byte rings in the named segment,
+one per direction, each with a single producer and a single consumer. A reader
+polls its ring for a moment (with more than one CPU), then sleeps on a futex that the writer wakes when it
+publishes a message. The socket stays open: it tells a sleeping end that the
+other one has gone. The functions below work the same over either transport.
+*/
+
 /**********************************************************/
 extern char * port;
+extern int tcpNoDelay;			//TRUE: connected sockets send at once instead of gathering small writes (Nagle), default
 /**********************************************************/
 
 void listenToSocket( char * port, int * mySocket );
@@ -33,6 +46,23 @@ int acceptConnection( int mySocket );
 void connectToTarget( char * port, char * ip, int * mySocket );
 //connects to a server (used by client)
 
+int readFully( int mySocket, void * buffer, int length );
+//receives exactly length bytes (over as many recv() calls as it takes), returns 0 on success and -1 on failure
+
+int offerSharedMemory( int mySocket );
+//server: creates a shared memory segment, sends NM_SHM_TRANSPORT and moves the connection there,
+//returns 0 on success and -1 if the connection stays on TCP (the segment name is removed once the client
+//answers over the rings, when it leaves, or at exit)
+
+void releaseSharedMemory( void );
+//server: removes the names of segments whose clients have not answered yet (done at exit, safe in a signal handler)
+
+int acceptSharedMemory( int mySocket );
+//client: after NM_SHM_TRANSPORT, maps the segment and moves the connection there, returns 0 on success and -1 on failure
+
+void setNoDelay( int mySocket );
+//sets TCP_NODELAY on a connected socket as tcpNoDelay says (done by acceptConnection and connectToTarget)
+
 int sendMsg( int msg, int mySocket );
 //sends a network message (one char)
 
@@ -42,6 +72,9 @@ int recvMsg( int mySocket );
 int sendMove( Move * moveToSend, int mySocket );
 //sends a move via mySocket
 
+int sendMsgAndMove( int msg, Move * moveToSend, int mySocket );
+//sends a network message and a move in one write (e.g. NM_PREPARE_TO_RECEIVE_MOVE)
+
 int getMove( Move * moveToGet, int mySocket );
 //receives a move from mySocket
 
@@ -54,9 +87,21 @@ int getName( char textToGet[ MAX_NAME_LENGTH + 1 ], int mySocket );
 int sendPosition( Position * posToSend, int mySocket );
 //used to send position struct
 
+int sendMsgAndPosition( int msg, Position * posToSend, int mySocket );
+//sends a network message and a position in one write (NM_NEW_POSITION)
+
 void getPosition( Position * posToGet, int mySocket );
 //used to receive position struct
 
+int sendPackedPosition( Position * posToSend, int mySocket );
+//used to send a position packed to PACKED_POSITION_BYTES
+
+int sendMsgAndPackedPosition( int msg, Position * posToSend, int mySocket );
+//sends a network message and a packed position in one write (NM_NEW_POSITION_PACKED)
+
+void getPackedPosition( Position * posToGet, int mySocket );
+//used to receive a packed position
+
 #endif
 
 
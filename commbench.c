@@ -0,0 +1,177 @@
+#include "global.h"
+#include "board.h"
+#include "move.h"
+#include "comm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <sys/wait.h>
+
+/*
+ * Move round-trip latency of the protocol over loopback TCP.
+ *
+ * Two child processes play the clients (they take the opponent's moves and answer
+ * every NM_REQUEST_MOVE at once), the parent plays the turn of server.c: the
+ * move just played goes to the waiting client (NM_PREPARE_TO_RECEIVE_MOVE and the
+ * move), NM_REQUEST_MOVE goes to the other one, and the turn ends when its move
+ * is in. Every mode times the same turns on new connections:
+ *	split, Nagle		message code and payload in separate writes, Nagle on (comm.c before)
+ *	split, nodelay		the same with TCP_NODELAY
+ *	writev, Nagle		message code and payload in one write, Nagle on
+ *	writev, nodelay		one write and TCP_NODELAY (comm.c now)
+ *	shared memory		the rings of server -m (comm.h)
+ */
+
+#define WARMUP_TURNS 100
+
+/**********************************************************/
+int turns = 2000;
+
+/**********************************************************/
+double seconds( struct timespec * t0, struct timespec * t1 )
+{
+	return ( t1->tv_sec - t0->tv_sec ) + ( t1->tv_nsec - t0->tv_nsec ) / 1e9;
+}
+
+/**********************************************************/
+int compareTimes( const void * a, const void * b )
+{
+	double x = *( double * ) a, y = *( double * ) b;
+	return ( x > y ) - ( x < y );
+}
+
+/**********************************************************/
+void clientLoop( void )
+{
+	/* a client that always has its move ready */
+	Move move;
+	int mySocket, msg;
+
+	connectToTarget( port, "127.0.0.1", &mySocket );
+	move.tile[ 0 ] = 3;
+	move.tile[ 1 ] = 4;
+
+	while( ( msg = recvMsg( mySocket ) ) != NM_QUIT )
+	{
+		if( msg == NM_PREPARE_TO_RECEIVE_MOVE )
+			getMove( &move, mySocket );
+		else if( msg == NM_SHM_TRANSPORT && acceptSharedMemory( mySocket ) < 0 )
+			exit( 1 );
+		else if( msg == NM_REQUEST_MOVE )
+			sendMove( &move, mySocket );
+	}
+
+	close( mySocket );
+	exit( 0 );
+}
+
+/**********************************************************/
+void runMode( char * name, int serverSocket, int coalesce, int noDelay, int shm )
+{
+	int client[ 2 ], k, t, mover;
+	pid_t pid[ 2 ];
+	double * times = malloc( sizeof( double ) * turns ), sum = 0;
+	struct timespec t0, t1;
+	Move move;
+
+	if( times == NULL )
+	{
+		printf( "ERROR: Out of memory\n" );
+		exit( 1 );
+	}
+
+	tcpNoDelay = noDelay;		//both ends of the connections
+	for( k = 0; k < 2; k++ )
+	{
+		fflush( stdout );
+		if( ( pid[ k ] = fork() ) == 0 )
+			clientLoop();
+		if( ( client[ k ] = acceptConnection( serverSocket ) ) < 0 )
+			exit( 1 );
+		if( shm && offerSharedMemory( client[ k ] ) < 0 )
+			exit( 1 );
+	}
+
+	move.tile[ 0 ] = 3;
+	move.tile[ 1 ] = 4;
+	for( t = -WARMUP_TURNS; t < turns; t++ )
+	{
+		mover = t & 1;
+
+		clock_gettime( CLOCK_MONOTONIC, &t0 );
+		if( coalesce )
+			sendMsgAndMove( NM_PREPARE_TO_RECEIVE_MOVE, &move, client[ 1 - mover ] );
+		else
+		{
+			sendMsg( NM_PREPARE_TO_RECEIVE_MOVE, client[ 1 - mover ] );
+			sendMove( &move, client[ 1 - mover ] );
+		}
+		sendMsg( NM_REQUEST_MOVE, client[ mover ] );
+		if( getMove( &move, client[ mover ] ) < 0 )
+			exit( 1 );
+		clock_gettime( CLOCK_MONOTONIC, &t1 );
+
+		if( t >= 0 )
+		{
+			times[ t ] = seconds( &t0, &t1 ) * 1e6;
+			sum += times[ t ];
+		}
+	}
+
+	for( k = 0; k < 2; k++ )
+	{
+		sendMsg( NM_QUIT, client[ k ] );
+		waitpid( pid[ k ], NULL, 0 );
+		close( client[ k ] );
+	}
+
+	qsort( times, turns, sizeof( double ), compareTimes );
+	printf( "%-16s %9.1f %9.1f %9.1f %9.1f\n", name, sum / turns, times[ turns / 2 ], times[ turns * 99 / 100 ], times[ turns - 1 ] );
+	free( times );
+}
+
+/**********************************************************/
+int main( int argc, char ** argv )
+{
+	int c, serverSocket;
+
+	port = "6098";
+	opterr = 0;
+	while( ( c = getopt( argc, argv, "n:p:h" ) ) != -1 )
+		switch( c )
+		{
+			case 'h':
+				printf( "[-n turns] [-p port]\n" );
+				return 0;
+			case 'n':
+				turns = atoi( optarg );
+				if( turns < 1 ) turns = 1;
+				break;
+			case 'p':
+				port = optarg;
+				break;
+			case '?':
+				if( isprint( optopt ) )
+					printf( "Unknown option or missing argument -%c\n", ( char ) optopt );
+				else
+					printf( "Unknown option character -%c\n", ( char ) optopt );
+				return 1;
+			default:
+				return 1;
+		}
+
+	listenToSocket( port, &serverSocket );
+
+	printf( "%d turns (move to the waiting client, request to the other one, its move back), microseconds:\n", turns );
+	printf( "%-16s %9s %9s %9s %9s\n", "mode", "mean", "median", "p99", "max" );
+	runMode( "split, Nagle", serverSocket, FALSE, FALSE, FALSE );
+	runMode( "split, nodelay", serverSocket, FALSE, TRUE, FALSE );
+	runMode( "writev, Nagle", serverSocket, TRUE, FALSE, FALSE );
+	runMode( "writev, nodelay", serverSocket, TRUE, TRUE, FALSE );
+	runMode( "shared memory", serverSocket, TRUE, TRUE, TRUE );
+
+	close( serverSocket );
+	return 0;
+}
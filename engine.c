@@ -0,0 +1,98 @@
+#include "engine.h"
+#include "pattern.h"
+#include "minimax.h"
+#include "tt.h"
+#include "nnue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+void getEngine(Engine *engine){
+    engine->evaluator = evaluator;
+    engine->evalWeights = evalWeights;
+    engine->patternWeights = patternWeights;
+    engine->lazyEval = lazyEval;
+    engine->forwardPruning = forwardPruning;
+    engine->searchPrefetch = searchPrefetch;
+    engine->evalCacheVersion = evalCacheVersion;
+    engine->ttSalt = ttSalt;
+}
+
+
+void setEngine(Engine *engine){
+    evaluator = engine->evaluator;
+    evalWeights = engine->evalWeights;
+    patternWeights = engine->patternWeights;
+    lazyEval = engine->lazyEval;
+    forwardPruning = engine->forwardPruning;
+    searchPrefetch = engine->searchPrefetch;
+    evalCacheVersion = engine->evalCacheVersion;
+    ttSalt = engine->ttSalt;
+}
+
+
+void newEngine(Engine *engine){
+    static uint64_t salts = 0;
+
+    clearEvalCache();
+    getEngine(engine);
+    engine->ttSalt = __atomic_add_fetch(&salts, 0x9E3779B97F4A7C15ULL, __ATOMIC_RELAXED);
+}
+
+
+int parseEngine(char *spec, Engine *engine, int *depth){
+    char *copy = strdup(spec), *item, *save = NULL;
+    char *weightsFile = NULL;
+    short *defaultPatterns = patternWeights;
+    int ok = (copy != NULL);
+
+    for (item = ok ? strtok_r(copy, ",", &save) : NULL; item != NULL && ok; item = strtok_r(NULL, ",", &save)) {
+        if (strcmp(item, "e=classic") == 0)
+            evaluator = EVAL_CLASSIC;
+        else if (strcmp(item, "e=pattern") == 0)
+            evaluator = EVAL_PATTERN;
+        else if (strcmp(item, "e=nnue") == 0)
+            evaluator = EVAL_NNUE;
+        else if (strncmp(item, "w=", 2) == 0)
+            weightsFile = item + 2;
+        else if (strncmp(item, "d=", 2) == 0 && atoi(item + 2) > 0)
+            *depth = atoi(item + 2);
+        else if (strcmp(item, "F") == 0)
+            forwardPruning = FALSE;
+        else if (strcmp(item, "L") == 0)
+            lazyEval = FALSE;
+        else {
+            printf("Unknown engine setting %s\n", item);
+            ok = FALSE;
+        }
+    }
+
+    if (ok && evaluator == EVAL_NNUE && !nnueEnabled) {
+        printf("The nnue evaluation needs a network\n");
+        ok = FALSE;
+    }
+    if (ok && weightsFile != NULL) {
+        if (evaluator == EVAL_PATTERN) {
+            // a table of its own, other engines may use the default one
+            if ((patternWeights = malloc(sizeof(short) * PATTERN_PHASES * patternTableSize)) == NULL) {
+                printf("ERROR: Out of memory\n");
+                patternWeights = defaultPatterns;
+                ok = FALSE;
+            } else {
+                memcpy(patternWeights, defaultPatterns, sizeof(short) * PATTERN_PHASES * patternTableSize);
+                ok = (loadPatternWeights(weightsFile) == 0);
+            }
+        } else if (evaluator == EVAL_CLASSIC) {
+            ok = (loadEvalWeights(weightsFile) == 0);
+        } else {
+            printf("The network is not an engine setting\n");
+            ok = FALSE;
+        }
+    }
+
+    newEngine(engine);
+    patternWeights = defaultPatterns;
+    free(copy);
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,43 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "eval.h"
+
+/*
+ * Engine settings: evaluation, weights and search options. The variables that
+ * hold them (evaluator, evalWeights, patternWeights, lazyEval, forwardPruning,
+ * searchPrefetch, evalCacheVersion and ttSalt) are per thread, so threads can
+ * play different engines against each other in one process. A new thread starts
+ * with the defaults; getEngine() and setEngine() copy the settings of one thread
+ * to another one, or switch a thread between engines.
+ */
+typedef struct {
+    int evaluator;
+    EvalWeights evalWeights;
+    short *patternWeights;		// tables are shared, not copied
+    int lazyEval;
+    int forwardPruning;
+    int searchPrefetch;
+    uint32_t evalCacheVersion;	// own version: cached evaluations of other engines do not match
+    uint64_t ttSalt;			// own salt: transposition table entries of other engines do not match
+} Engine;
+
+void getEngine(Engine *engine);
+// the settings of this thread
+
+void setEngine(Engine *engine);
+// makes engine the settings of this thread
+
+void newEngine(Engine *engine);
+// the settings of this thread with their own cache version and salt (an engine that shares no table entries)
+
+int parseEngine(char *spec, Engine *engine, int *depth);
+// applies a comma separated list of settings to this thread and takes them as a new engine (newEngine()):
+//	e=classic|pattern|nnue	evaluation (nnue needs a loaded network)
+//	w=file					weights of the evaluation (pattern weights get a table of their own)
+//	d=depth					plies searched below every root move (depth is left alone without it)
+//	F						no forward pruning
+//	L						no lazy evaluation
+// returns 0 on success and -1 on failure
+
+#endif
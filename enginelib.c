@@ -0,0 +1,79 @@
+#include "enginelib.h"
+#include "engine.h"
+#include "minimax.h"
+#include "tt.h"
+#include "nnue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DEFAULT_DEPTH 4
+
+static Engine libEngine;
+static int libDepth = DEFAULT_DEPTH;
+
+
+int hexEngineVersion(void){
+    return ENGINE_LIB_VERSION;
+}
+
+
+int hexEngineRadius(void){
+    return HEX_BOARD_RADIUS;
+}
+
+
+int hexEngineInit(char *spec){
+    char *copy = strdup(spec), *rest = malloc(strlen(spec) + 1), *item, *save = NULL;
+    int cacheMB = EVAL_CACHE_MB, ttMB = TT_MB, ok = (copy != NULL && rest != NULL);
+    Position pos;
+
+    initPosition(&pos);    // also sets up the tables the threads share
+
+    // the table and network settings, the rest is for parseEngine()
+    if (ok)
+        rest[0] = '\0';
+    for (item = ok ? strtok_r(copy, ",", &save) : NULL; item != NULL && ok; item = strtok_r(NULL, ",", &save)) {
+        if (strncmp(item, "n=", 2) == 0)
+            ok = (loadNetwork(item + 2) == 0);
+        else if (strncmp(item, "c=", 2) == 0)
+            cacheMB = atoi(item + 2);
+        else if (strncmp(item, "t=", 2) == 0)
+            ttMB = atoi(item + 2);
+        else {
+            if (rest[0] != '\0')
+                strcat(rest, ",");
+            strcat(rest, item);
+        }
+    }
+
+    if (ok && (initEvalCache(cacheMB) < 0 || initTT(ttMB, NULL) < 0))
+        ok = FALSE;
+    if (ok && parseEngine(rest, &libEngine, &libDepth) < 0)
+        ok = FALSE;
+
+    free(copy);
+    free(rest);
+    return ok ? 0 : -1;
+}
+
+
+int hexEngineMove(unsigned char packed[PACKED_POSITION_BYTES], int *row, int *col){
+    Position pos;
+    Move move;
+    int score;
+
+    setEngine(&libEngine);
+    unpackPosition(packed, &pos);
+    ttNewSearch();
+    score = rootSearch(&pos, pos.turn, TRUE, libDepth, &move);
+
+    *row = move.tile[0];
+    *col = move.tile[1];
+    return score;
+}
+
+
+long long hexEngineNodes(void){
+    return searchStats.nodes + searchStats.leaves;
+}
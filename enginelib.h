@@ -0,0 +1,41 @@
+#ifndef ENGINELIB_H
+#define ENGINELIB_H
+
+#include "pack.h"
+
+/*
+ * The engine as a shared object (make hexengine.so). Every symbol of the build is
+ * hidden except these entry points, so two builds (e.g. before and after a change)
+ * can be loaded with dlopen() into one process and each keeps its own code, tables
+ * and settings. Positions cross the boundary packed (pack.h): the builds may lay
+ * out Position differently, but they must be built for the same radius.
+ */
+#define ENGINE_LIB_VERSION 1
+
+#ifdef ENGINE_LIB
+#define ENGINE_EXPORT __attribute__((visibility("default")))
+#else
+#define ENGINE_EXPORT
+#endif
+
+ENGINE_EXPORT int hexEngineVersion(void);
+// ENGINE_LIB_VERSION of the build
+
+ENGINE_EXPORT int hexEngineRadius(void);
+// HEX_BOARD_RADIUS of the build
+
+ENGINE_EXPORT int hexEngineInit(char *spec);
+// sets the engine up once: the settings of parseEngine() (engine.h) and
+//	n=file		network of the nnue evaluation
+//	c=MB		evaluation cache size (EVAL_CACHE_MB)
+//	t=MB		transposition table size (TT_MB)
+// returns 0 on success and -1 on failure
+
+ENGINE_EXPORT int hexEngineMove(unsigned char packed[PACKED_POSITION_BYTES], int *row, int *col);
+// best move of the side to move, searched on the calling thread (any number of threads at once),
+// returns its score (WHITE maximizes), *row is NULL_MOVE if there is no legal move
+
+ENGINE_EXPORT long long hexEngineNodes(void);
+// nodes (interior and leaves) searched by the calling thread
+
+#endif
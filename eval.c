@@ -0,0 +1,491 @@
+#include "eval.h"
+#include "alloc.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+__thread int evaluator = EVAL_CLASSIC;
+
+EvalCacheEntry *evalCache = NULL;
+uint64_t evalCacheMask;
+__thread uint32_t evalCacheVersion = 1;
+static uint32_t evalCacheVersions = 1;	// last version handed out
+static size_t evalCacheMapped;			// bytes allocTable() mapped for the cache
+__thread EvalStats evalStats;
+__thread int lazyEval = TRUE;
+
+#define START_EMPTIES (HEX_CELLS - 7)
+
+#define DEFAULT_WEIGHTS {           \
+        [F_PIECES] = 50,            \
+        [F_MOBILITY] = 3,           \
+        [F_BORDER] = 15,            \
+        [F_FRONTIER] = -1,          \
+        [F_PARITY] = 10,            \
+        [F_STABLE] = 20,            \
+        [F_POT_MOBILITY] = 1,       \
+    }
+
+// Default (hand-picked) weights, tuner output can replace them with loadEvalWeights().
+__thread EvalWeights evalWeights = {
+    .w = { DEFAULT_WEIGHTS, DEFAULT_WEIGHTS, DEFAULT_WEIGHTS },
+    .endgame = 55,
+};
+
+// Opening, midgame and late midgame, evenly spaced down to the disc-count endgame.
+const int phaseEmpties[EVAL_PHASES + 1] = {
+    START_EMPTIES,
+    START_EMPTIES - 1 * (START_EMPTIES - ENDGAME_EMPTIES) / EVAL_PHASES,
+    START_EMPTIES - 2 * (START_EMPTIES - ENDGAME_EMPTIES) / EVAL_PHASES,
+    ENDGAME_EMPTIES,
+};
+
+const char *featureNames[EVAL_FEATURES] = {
+    [F_PIECES] = "pieces",
+    [F_MOBILITY] = "mobility",
+    [F_BORDER] = "border",
+    [F_FRONTIER] = "frontier",
+    [F_PARITY] = "parity",
+    [F_STABLE] = "stable",
+    [F_POT_MOBILITY] = "pot_mobility",
+};
+
+
+void evalFeatures(Position *pos, int f[EVAL_FEATURES]){
+	/*
+	 *	Computes the features of the classic evaluation, each one as (white - black):
+	 *		+ Numner of pieces of each player (the more the better)
+	 *		+ Number of valid moves of each player (the more the better, popcount of the legal-move bitboards)
+	 *		+ Number of pieces on the border of the hexagon (hard to capture, so the more the better)
+	 *		- Number of pieces that could be captured (frontier pieces, these are liability, the less the better()
+	 *		+ Number of odd sized empty regions for the side to move (it can take the last tile of each one)
+	 *		+ Number of stable discs (discs that can never be flipped)
+	 *		+ Potential mobility: empty tiles next to opponent discs (future moves, the more the better)
+	 *
+	 *	Pieces, border, frontier and region counts are kept up to date by doMove(), so they cost nothing here.
+	 */
+    BBFeatures bb;
+
+    // Incrementally maintained features.
+    f[F_PIECES] = pos->score[WHITE] - pos->score[BLACK];
+    f[F_PARITY] = (pos->turn == WHITE) ? pos->oddRegions : -pos->oddRegions;
+    f[F_BORDER] = pos->border[WHITE] - pos->border[BLACK];
+    f[F_FRONTIER] = pos->frontier[WHITE] - pos->frontier[BLACK];
+
+    f[F_STABLE] = bbCount(stableDiscs(pos, WHITE)) - bbCount(stableDiscs(pos, BLACK));
+
+    // Mobility with bitboards, potential mobility with the (vectorized) bitboard feature kernel.
+    f[F_MOBILITY] = bbCount(legalMoves(pos, WHITE)) - bbCount(legalMoves(pos, BLACK));
+    bbFeatures(pos->pieces, pos->illegal, &bb);
+    f[F_POT_MOBILITY] = bb.potMobility[WHITE] - bb.potMobility[BLACK];
+}
+
+
+void evalPhase(int empties, int *phase, int *t){
+    int k;
+
+    if (empties >= phaseEmpties[0]) {
+        *phase = 0;
+        *t = 0;
+        return;
+    }
+
+    for (k = 0; k < EVAL_PHASES; k++)
+        if (empties >= phaseEmpties[k + 1]) {
+            *phase = k;
+            *t = (phaseEmpties[k] - empties) * EVAL_TAPER_SCALE / (phaseEmpties[k] - phaseEmpties[k + 1]);
+            return;
+        }
+
+    *phase = EVAL_PHASES;
+    *t = 0;
+}
+
+
+int initEvalCache(int megabytes){
+    size_t entries = 1;
+
+    freeTable(evalCache, evalCacheMapped);
+    evalCache = NULL;
+    if (megabytes <= 0)
+        return 0;
+
+    while (2 * entries * sizeof(EvalCacheEntry) <= (size_t) megabytes << 20)
+        entries *= 2;
+
+    if ((evalCache = allocTable(entries * sizeof(EvalCacheEntry), NULL, &evalCacheMapped)) == NULL) {
+        printf("ERROR: Cannot allocate a %d MB evaluation cache\n", megabytes);
+        return -1;
+    }
+    evalCacheMask = entries - 1;
+    memset(&evalStats, 0, sizeof(evalStats));
+    return 0;
+}
+
+
+size_t evalCacheBytes(void){
+    return evalCache ? (evalCacheMask + 1) * sizeof(EvalCacheEntry) : 0;
+}
+
+
+void clearEvalCache(void){
+    // Entries of older versions never match, no need to touch the table.
+    evalCacheVersion = __atomic_add_fetch(&evalCacheVersions, 1, __ATOMIC_RELAXED);
+}
+
+
+static uint64_t hashBytes(uint64_t h, const void *p, size_t n){
+    // FNV-1a
+    const unsigned char *b = p;
+
+    while (n--)
+        h = (h ^ *b++) * 0x100000001B3ULL;
+    return h;
+}
+
+
+uint64_t evalFingerprint(void){
+    uint64_t h = 0xCBF29CE484222325ULL;
+
+    h = hashBytes(h, &evaluator, sizeof(evaluator));
+    h = hashBytes(h, &evalWeights, sizeof(evalWeights));	// the endgame weight counts for every evaluator
+    if (evaluator == EVAL_PATTERN && patternWeights != NULL)
+        h = hashBytes(h, patternWeights, sizeof(short) * PATTERN_PHASES * patternTableSize);
+    if (evaluator == EVAL_NNUE) {
+        h = hashBytes(h, nnueHiddenWeights, sizeof(nnueHiddenWeights));
+        h = hashBytes(h, nnueHiddenBias, sizeof(nnueHiddenBias));
+        h = hashBytes(h, nnueOutputWeights, sizeof(nnueOutputWeights));
+        h = hashBytes(h, &nnueOutputBias, sizeof(nnueOutputBias));
+        h = hashBytes(h, &nnueShift, sizeof(nnueShift));
+    }
+    return h;
+}
+
+
+static void blendWeights(int empties, int w[EVAL_FEATURES]){
+    // Weights of the two phases around empties blended into one set, scaled by EVAL_TAPER_SCALE.
+    int phase, t, k;
+
+    evalPhase(empties, &phase, &t);
+    for (k = 0; k < EVAL_FEATURES; k++) {
+        w[k] = (EVAL_TAPER_SCALE - t) * evalWeights.w[phase][k];
+        if (phase + 1 < EVAL_PHASES)
+            w[k] += t * evalWeights.w[phase + 1][k];
+        else if (k == F_PIECES)
+            w[k] += t * evalWeights.endgame;
+    }
+}
+
+
+static void addRange(int w, int lo, int hi, int *min, int *max){
+    // Adds w * f for f in [lo, hi] to the range [*min, *max].
+    if (w >= 0) {
+        *min += w * lo;
+        *max += w * hi;
+    } else {
+        *min += w * hi;
+        *max += w * lo;
+    }
+}
+
+
+static int outsideWindow(int min, int max, int alpha, int beta, int *val){
+    if (max / EVAL_TAPER_SCALE <= alpha) {
+        *val = max / EVAL_TAPER_SCALE;
+        return TRUE;
+    }
+    if (min / EVAL_TAPER_SCALE >= beta) {
+        *val = min / EVAL_TAPER_SCALE;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+
+static int evaluateStaged(Position *pos, int alpha, int beta, int *exact){
+	/*
+	 *	The classic evaluation in three stages, cheapest first. After the first two the terms
+	 *	still missing are bounded, and if the score can not reach the window (alpha, beta)
+	 *	whatever they are, that bound is returned and *exact is FALSE.
+	 *		1. incremental terms and potential mobility (a few ns)
+	 *		   mobility is at most the potential mobility (a move is an empty tile next to an opponent disc),
+	 *		   and the stable discs of a side are at most its discs
+	 *		2. stable discs, mobility bounded as above
+	 *		3. mobility, the exact score
+	 */
+    int w[EVAL_FEATURES], f[EVAL_FEATURES], k, sum = 0, min, max, val;
+    BBFeatures bb;
+
+    *exact = FALSE;
+    blendWeights(HEX_CELLS - pos->score[WHITE] - pos->score[BLACK], w);
+
+    // 1. Same features as evalFeatures().
+    f[F_PIECES] = pos->score[WHITE] - pos->score[BLACK];
+    f[F_PARITY] = (pos->turn == WHITE) ? pos->oddRegions : -pos->oddRegions;
+    f[F_BORDER] = pos->border[WHITE] - pos->border[BLACK];
+    f[F_FRONTIER] = pos->frontier[WHITE] - pos->frontier[BLACK];
+    bbFeatures(pos->pieces, pos->illegal, &bb);
+    f[F_POT_MOBILITY] = bb.potMobility[WHITE] - bb.potMobility[BLACK];
+
+    for (k = 0; k < EVAL_FEATURES; k++)
+        if (k != F_STABLE && k != F_MOBILITY)
+            sum += w[k] * f[k];
+
+    if (lazyEval) {
+        min = max = sum;
+        addRange(w[F_MOBILITY], -bb.potMobility[BLACK], bb.potMobility[WHITE], &min, &max);
+        addRange(w[F_STABLE], -pos->score[BLACK], pos->score[WHITE], &min, &max);
+        if (outsideWindow(min, max, alpha, beta, &val)) {
+            evalStats.lazyExits[0]++;
+            return val;
+        }
+    }
+
+    // 2.
+    f[F_STABLE] = bbCount(stableDiscs(pos, WHITE)) - bbCount(stableDiscs(pos, BLACK));
+    sum += w[F_STABLE] * f[F_STABLE];
+
+    if (lazyEval) {
+        min = max = sum;
+        addRange(w[F_MOBILITY], -bb.potMobility[BLACK], bb.potMobility[WHITE], &min, &max);
+        if (outsideWindow(min, max, alpha, beta, &val)) {
+            evalStats.lazyExits[1]++;
+            return val;
+        }
+    }
+
+    // 3.
+    f[F_MOBILITY] = bbCount(legalMoves(pos, WHITE)) - bbCount(legalMoves(pos, BLACK));
+    sum += w[F_MOBILITY] * f[F_MOBILITY];
+
+    *exact = TRUE;
+    return sum / EVAL_TAPER_SCALE;
+}
+
+
+int evaluate(Position *pos){
+    return evaluateWindow(pos, -EVAL_INF, EVAL_INF);
+}
+
+
+int evaluateWindow(Position *pos, int alpha, int beta){
+	/*
+	 *	Evaluation function of current state (pos).
+	 *
+	 *	f(state) = sum of evalWeights.w[phase][k] * feature[k] (see evalFeatures()), interpolated
+	 *	between the two phases around the number of empty tiles (see evalPhase()).
+	 *	The last phase blends into evalWeights.endgame * (num_of_white - num_of_black),
+	 *	which is all that is left above ENDGAME_DISCS.
+	 *	With evaluator == EVAL_PATTERN the pattern tables replace the features (except in the endgame),
+	 *	with EVAL_NNUE the network does. Only the classic evaluation is worth caching, the
+	 *	others cost about as much as a cache miss.
+	 *
+	 *	The classic evaluation is lazy (see evaluateStaged()): if the score is sure to be
+	 *	<= alpha or >= beta it may stop early and return a bound on that side instead.
+	 *
+	 *	returns an int (f(state)).
+	 */
+    int empties = HEX_CELLS - pos->score[WHITE] - pos->score[BLACK];
+    EvalCacheEntry *entry;
+    uint64_t check, data;
+    int val, exact;
+
+    if (pos->score[WHITE] + pos->score[BLACK] > ENDGAME_DISCS)
+        return evalWeights.endgame * (pos->score[WHITE] - pos->score[BLACK]); // If it's endgame prioritize the pieces difference over others heuristics.
+
+    if (evaluator == EVAL_PATTERN)
+        return patternEvaluate(pos->patternIndex, empties);
+
+    if (evaluator == EVAL_NNUE)
+        return nnueEvaluate(pos->nnueAcc);
+
+    if (evalCache == NULL)
+        return evaluateStaged(pos, alpha, beta, &exact);
+
+    // Relaxed atomic loads and stores: each word is read and written whole, the xor check does the rest.
+    evalStats.probes++;
+    entry = &evalCache[pos->hash & evalCacheMask];
+    check = __atomic_load_n(&entry->check, __ATOMIC_RELAXED);
+    data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+    if ((check ^ data) == pos->hash && (uint32_t) (data >> 32) == evalCacheVersion) {
+        evalStats.hits++;
+        return (int32_t) (uint32_t) data;
+    }
+
+    val = evaluateStaged(pos, alpha, beta, &exact);
+    if (!exact)
+        return val;
+
+    data = ((uint64_t) evalCacheVersion << 32) | (uint32_t) val;
+    __atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->check, pos->hash ^ data, __ATOMIC_RELAXED);
+    return val;
+}
+
+
+void evaluateChildren(Position *pos, Move moves[], int count, int scores[]){
+	/*
+	 *	Scores of the positions after each of moves (legal moves of one color), for move ordering.
+	 *
+	 *	Children are not built with doMove(): each one is the parent plus the placed and flipped discs.
+	 *	Everything that does not depend on the move is computed once: the phase and its blended weights,
+	 *	the stable discs and the parity of the parent. Then the per-child features go into one array per
+	 *	feature and the weighted sums run over all children at once (a loop the compiler vectorizes).
+	 *
+	 *	Same as evaluate() on each child, except for the classic evaluation, where stable discs are the
+	 *	parent's (a lower bound, stable discs stay stable) and parity ignores regions split by the move.
+	 */
+    int f[EVAL_FEATURES][HEX_CELLS], sum[HEX_CELLS], w[EVAL_FEATURES];
+    int color, sign, discs, empties, c, k, index, parity, stable;
+    int diff = pos->score[WHITE] - pos->score[BLACK];
+    unsigned short patterns[PATTERN_INSTANCES];
+    short acc[NNUE_HIDDEN];
+    BitBoard flips, pieces[2];
+    BBFeatures bb;
+
+    if (count <= 0)
+        return;
+
+    color = moves[0].color;
+    sign = (color == WHITE) ? 1 : -1;
+    discs = pos->score[WHITE] + pos->score[BLACK] + 1;
+    empties = HEX_CELLS - discs;
+
+    if (discs > ENDGAME_DISCS) {
+        for (c = 0; c < count; c++)
+            scores[c] = evalWeights.endgame * (diff + sign * (1 + 2 * bbCount(flippedDiscs(pos, &moves[c]))));
+        return;
+    }
+
+    if (evaluator == EVAL_PATTERN || evaluator == EVAL_NNUE) {
+        for (c = 0; c < count; c++) {
+            flips = flippedDiscs(pos, &moves[c]);
+            if (evaluator == EVAL_PATTERN) {
+                memcpy(patterns, pos->patternIndex, sizeof(patterns));
+                patternUpdate(patterns, moves[c].tile[0], moves[c].tile[1], color + 1);
+                for (index = bbFirst(flips); index >= 0; bbClear(&flips, index), index = bbFirst(flips))
+                    patternUpdate(patterns, BB_ROW(index), BB_COL(index), (color == WHITE) ? -1 : 1);
+                scores[c] = patternEvaluate(patterns, empties);
+            } else {
+                memcpy(acc, pos->nnueAcc, sizeof(acc));
+                nnueAdd(acc, moves[c].tile[0], moves[c].tile[1], color);
+                for (index = bbFirst(flips); index >= 0; bbClear(&flips, index), index = bbFirst(flips))
+                    nnueFlip(acc, BB_ROW(index), BB_COL(index), getOtherSide(color), color);
+                scores[c] = nnueEvaluate(acc);
+            }
+        }
+        return;
+    }
+
+    // Shared by all children: blended weights (see evaluate()), parent stability and parity.
+    blendWeights(empties, w);
+    stable = bbCount(stableDiscs(pos, WHITE)) - bbCount(stableDiscs(pos, BLACK));
+    parity = (getOtherSide(pos->turn) == WHITE) ? 1 : -1;
+
+    // Per child features.
+    for (c = 0; c < count; c++) {
+        index = BB_INDEX(moves[c].tile[0], moves[c].tile[1]);
+        flips = flippedDiscs(pos, &moves[c]);
+        bbSet(&flips, index);
+        pieces[color] = bbOr(pos->pieces[color], flips);
+        pieces[getOtherSide(color)] = bbAndNot(pos->pieces[getOtherSide(color)], flips);
+
+        bbFeatures(pieces, pos->illegal, &bb);
+        f[F_PIECES][c] = bb.discs[WHITE] - bb.discs[BLACK];
+        f[F_BORDER][c] = bb.border[WHITE] - bb.border[BLACK];
+        f[F_FRONTIER][c] = bb.frontier[WHITE] - bb.frontier[BLACK];
+        f[F_POT_MOBILITY][c] = bb.potMobility[WHITE] - bb.potMobility[BLACK];
+        f[F_MOBILITY][c] = bbCount(bbAndNot(legalMovesOf(pieces[WHITE], pieces[BLACK]), pos->illegal))
+            - bbCount(bbAndNot(legalMovesOf(pieces[BLACK], pieces[WHITE]), pos->illegal));
+        f[F_PARITY][c] = parity * (pos->oddRegions + (bbTest(pos->oddEmpties, index) ? -1 : 1));
+        f[F_STABLE][c] = stable;
+    }
+
+    // Weighted sums of all children.
+    for (c = 0; c < count; c++)
+        sum[c] = 0;
+    for (k = 0; k < EVAL_FEATURES; k++)
+        for (c = 0; c < count; c++)
+            sum[c] += w[k] * f[k][c];
+    for (c = 0; c < count; c++)
+        scores[c] = sum[c] / EVAL_TAPER_SCALE;
+}
+
+
+int loadEvalWeights(char *fileName){
+	/*
+	 *	Reads a weights file: one "name value" pair per line, '#' starts a comment.
+	 *	Names are the featureNames and "endgame", missing ones keep their value.
+	 *	"name.phase value" sets the weight of one phase, "name value" sets it in every phase.
+	 */
+    FILE *f;
+    char line[256], name[64], *dot;
+    int value, k, phase;
+
+    if ((f = fopen(fileName, "r")) == NULL) {
+        printf("ERROR: Cannot open weights file %s\n", fileName);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (line[0] == '#' || sscanf(line, "%63s %d", name, &value) != 2)
+            continue;
+
+        if (strcmp(name, "endgame") == 0) {
+            if (value <= 0) {
+                printf("ERROR: endgame weight must be positive (%s)\n", fileName);
+                fclose(f);
+                return -1;
+            }
+            evalWeights.endgame = value;
+            clearEvalCache();
+            continue;
+        }
+
+        phase = -1;
+        if ((dot = strchr(name, '.')) != NULL) {
+            *dot = '\0';
+            phase = atoi(dot + 1);
+        }
+
+        for (k = 0; k < EVAL_FEATURES; k++)
+            if (strcmp(name, featureNames[k]) == 0)
+                break;
+        if (k == EVAL_FEATURES || phase >= EVAL_PHASES) {
+            printf("ERROR: Unknown weight %s in %s\n", name, fileName);
+            fclose(f);
+            return -1;
+        }
+
+        clearEvalCache();
+        if (phase >= 0)
+            evalWeights.w[phase][k] = value;
+        else
+            for (phase = 0; phase < EVAL_PHASES; phase++)
+                evalWeights.w[phase][k] = value;
+    }
+
+    fclose(f);
+    return 0;
+}
+
+
+int saveEvalWeights(char *fileName, EvalWeights *weights){
+    FILE *f;
+
+    if ((f = fopen(fileName, "w")) == NULL) {
+        printf("ERROR: Cannot create weights file %s\n", fileName);
+        return -1;
+    }
+
+    fprintf(f, "# hexthello evaluation weights\n");
+    for (int phase = 0; phase < EVAL_PHASES; phase++) {
+        fprintf(f, "# phase %d (%d empty tiles)\n", phase, phaseEmpties[phase]);
+        for (int k = 0; k < EVAL_FEATURES; k++)
+            fprintf(f, "%s.%d %d\n", featureNames[k], phase, weights->w[phase][k]);
+    }
+    fprintf(f, "endgame %d\n", weights->endgame);
+
+    fclose(f);
+    return 0;
+}
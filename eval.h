@@ -0,0 +1,117 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include "board.h"
+#include <stddef.h>
+
+
+#define ENDGAME_EMPTIES (HEX_CELLS * 29 / 169)		// with this many empty tiles or less evaluate() only counts discs (29 at radius 7)
+#define ENDGAME_DISCS (HEX_CELLS - ENDGAME_EMPTIES)
+
+/*
+ * Tapered evaluation: there is one weight set per phase, anchored at a number
+ * of empty tiles. Between two anchors the score is interpolated linearly, and
+ * the last phase blends into the pure disc count at ENDGAME_EMPTIES.
+ */
+#define EVAL_PHASES 3
+
+/* evaluation functions, selected with the evaluator variable */
+#define EVAL_CLASSIC 0		// hand-weighted features (default)
+#define EVAL_PATTERN 1		// pattern tables (see pattern.h)
+#define EVAL_NNUE 2			// incrementally updated network (see nnue.h), needs loadNetwork()
+
+/* features of the classic evaluation, each one is (white - black) */
+#define F_PIECES 0			// discs
+#define F_MOBILITY 1		// legal moves
+#define F_BORDER 2			// discs on the outer ring
+#define F_FRONTIER 3		// discs next to an empty tile
+#define F_PARITY 4			// odd empty regions (counted for the side to move)
+#define F_STABLE 5			// discs that can never be flipped
+#define F_POT_MOBILITY 6	// empty tiles next to opponent discs
+#define EVAL_FEATURES 7
+
+// Weights of the classic evaluation.
+typedef struct {
+    int w[EVAL_PHASES][EVAL_FEATURES];	// weight of each feature in each phase
+    int endgame;						// evaluate() == endgame * (white - black) above ENDGAME_DISCS
+} EvalWeights;
+
+extern __thread int evaluator;			// per thread, like the other engine settings (engine.h)
+extern __thread EvalWeights evalWeights;
+extern const char *featureNames[EVAL_FEATURES];
+extern const int phaseEmpties[EVAL_PHASES + 1];	// anchor of each phase, the last one is ENDGAME_EMPTIES
+
+void evalPhase(int empties, int *phase, int *t);
+// the position sits between phase and phase + 1 (EVAL_PHASES is the pure disc count),
+// at t / EVAL_TAPER_SCALE of the way
+#define EVAL_TAPER_SCALE 256
+
+#define EVAL_INF 1000000		// larger than any score
+
+extern __thread int lazyEval;	// TRUE: evaluateWindow() may stop early (default)
+
+int evaluate(Position *pos);
+// static evaluation of pos (positive is good for WHITE)
+
+int evaluateWindow(Position *pos, int alpha, int beta);
+// evaluate() for a search window: if the score is <= alpha or >= beta it may return a bound on that side instead
+
+void evalFeatures(Position *pos, int f[EVAL_FEATURES]);
+// computes the features of the classic evaluation
+
+/*
+ * Evaluation cache: a direct-mapped table of classic evaluations keyed by the
+ * position hash. It is lossy (a new entry replaces the old one), separate from
+ * any search table, and lock-free: every entry stores key ^ data next to data,
+ * so an entry torn by two threads writing at once fails the key check and is a miss.
+ */
+#define EVAL_CACHE_MB 4		// default size
+
+// Evaluation cache entry, valid if (check ^ data) is the position hash.
+// data holds the score in the low 32 bits and the cache version in the high ones.
+typedef struct {
+    uint64_t check;
+    uint64_t data;
+} EvalCacheEntry;
+
+extern EvalCacheEntry *evalCache;	// NULL if the cache is off
+extern uint64_t evalCacheMask;
+extern __thread uint32_t evalCacheVersion;	// entries of other versions do not match (per thread: engines with other settings)
+
+typedef struct {
+    long long probes;		// evaluate() calls that looked in the cache
+    long long hits;
+    long long lazyExits[2];	// lazy evaluations stopped after the first and the second stage
+} EvalStats;
+
+extern __thread EvalStats evalStats;	// per thread
+
+int initEvalCache(int megabytes);
+// (re)allocates the cache with the largest power of two entries that fits, 0 turns it off, returns 0 on success and -1 on failure
+
+size_t evalCacheBytes(void);
+// memory used by the cache
+
+void clearEvalCache(void);
+// forgets every entry of this thread's version (a fresh version, called when the weights change)
+
+uint64_t evalFingerprint(void);
+// hash of this thread's evaluator and the weights it uses (scores saved under another one are not comparable)
+
+static inline void evalPrefetch(uint64_t hash){
+    // Starts loading the cache entry of a position that is about to be evaluated.
+    if (evalCache)
+        __builtin_prefetch(&evalCache[hash & evalCacheMask]);
+}
+
+void evaluateChildren(Position *pos, Move moves[], int count, int scores[]);
+// scores of the children of pos after each of moves (legal moves of one color) in one call, for move ordering
+// (same as evaluate() on each child, except that the classic evaluation approximates stability and parity)
+
+int loadEvalWeights(char *fileName);
+// reads "name value" or "name.phase value" lines into evalWeights, returns 0 on success and -1 on failure
+
+int saveEvalWeights(char *fileName, EvalWeights *weights);
+// writes weights in the format loadEvalWeights() reads, returns 0 on success and -1 on failure
+
+#endif
@@ -19,5 +19,7 @@ PlayerStruct * waitingPlayer;
 int numberOfGames = 1;				// 1 game by default
 int swapAfterEachGame = FALSE;		// If TRUE then after each game colors will be swaped
 									//(obviously has meaning only when numberOfGames > 1) use [-s] argument to enable.
+int packedPositions = FALSE;		// If TRUE then positions are sent packed (NM_NEW_POSITION_PACKED)
+int sharedMemory = FALSE;			// If TRUE then connections move to shared memory rings (NM_SHM_TRANSPORT, same host only)
 
 
@@ -33,5 +33,7 @@ extern PlayerStruct * waitingPlayer;
 
 extern int numberOfGames;
 extern int swapAfterEachGame;
+extern int packedPositions;
+extern int sharedMemory;
 
 #endif
@@ -24,10 +24,18 @@
 
 /**********************************************************/
 
-/* The size of our board */
+/* The size of our board (every binary is built for one radius: make RADIUS=5) */
+#ifndef HEX_BOARD_RADIUS
 #define HEX_BOARD_RADIUS 7
+#endif
+#if HEX_BOARD_RADIUS < 3 || HEX_BOARD_RADIUS > 8
+#error "HEX_BOARD_RADIUS must be between 3 and 8 (pattern indices are 16 bit)"
+#endif
 #define ARRAY_BOARD_SIZE (HEX_BOARD_RADIUS * 2 + 1)
 
+/* number of playable tiles of the hexagon */
+#define HEX_CELLS (3 * HEX_BOARD_RADIUS * (HEX_BOARD_RADIUS + 1) + 1)
+
 /* used to describe a null move (the only legal "move" when no move is available) */
 #define NULL_MOVE -50
 
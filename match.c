@@ -0,0 +1,694 @@
+#include "global.h"
+#include "board.h"
+#include "eval.h"
+#include "minimax.h"
+#include "tt.h"
+#include "pack.h"
+#include "engine.h"
+#include "enginelib.h"
+#include "nnue.h"
+#include "pattern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <pthread.h>
+
+/*
+ * Headless match between two engines, in one process.
+ *
+ * Games start from a file of opening positions (one per line, as the text input
+ * of the tuner: <HEX_CELLS tiles 'w' 'b' or '.', row by row> <side to move: w|b>,
+ * anything after that is ignored) or from random openings. Every opening is
+ * played twice with the colors swapped, by a pool of threads that take the next
+ * game from a shared counter.
+ *
+ * An engine is a comma separated list of settings (parseEngine() in engine.h):
+ *		e=classic|pattern|nnue	evaluation (classic)
+ *		w=file					weights of the evaluation (the nnue network is set with -n, one per process)
+ *		d=depth					plies searched below every root move (4)
+ *		F						no forward pruning
+ *		L						no lazy evaluation
+ * The engine settings are per thread, so a thread switches engine before every
+ * move; the evaluation cache and the transposition table are shared, each
+ * engine with its own keys. With so=file the engine is another build loaded as
+ * a shared object (enginelib.h), which also takes n=network, c=MB and t=MB for
+ * its own tables. Two engines of one build must load two copies of the file:
+ * dlopen() loads a file once, the second engine would set up the first one again.
+ * loadEngineLib() refuses that.
+ *
+ * Sequential probability ratio test (-S elo0:elo1[:alpha:beta]): after every
+ * pair of games the log-likelihood ratio of elo1 against elo0 is updated from
+ * the pair scores (pentanomial model) and the match stops as soon as it leaves
+ * [ log( beta / ( 1 - alpha ) ), log( ( 1 - beta ) / alpha ) ]: above, engine 1
+ * is better by elo1; below, it is not better than elo0.
+ */
+
+#define MAX_THREADS 64
+#define MAX_OPENINGS 1000000
+#define DEFAULT_DEPTH 4
+#define DEFAULT_PAIRS 100
+#define SPRT_PAIRS 50000		//most pairs of a test without -g
+
+/**********************************************************/
+typedef struct
+{
+	int ( * version )( void );
+	int ( * radius )( void );
+	int ( * init )( char * spec );
+	int ( * move )( unsigned char packed[ PACKED_POSITION_BYTES ], int * row, int * col );
+	long long ( * nodes )( void );
+} EngineLib;
+
+typedef struct
+{
+	Engine engine;
+	int depth;
+	char * spec;
+	EngineLib * lib;				// other build, NULL: this one
+} Player;
+
+typedef struct
+{
+	int wins, draws, losses;		// of engine 1
+	double discSum, discSquares;	// disc difference for engine 1
+	long long nodes, moves;
+} Totals;
+
+/**********************************************************/
+Player players[ 2 ];
+Position * openings = NULL;
+int openingCount = 0;			// 0: random openings
+int openingPlies = 6;
+int games = 2 * DEFAULT_PAIRS;
+int threads = 4;
+int nextGame = 0, gamesDone = 0;
+int reportEvery;
+Totals totals;
+FILE * dump = NULL;
+pthread_mutex_t matchLock = PTHREAD_MUTEX_INITIALIZER;
+unsigned int matchSeed = 1;
+
+/* game pairs and the test */
+unsigned char * pairGames = NULL;	// games of each pair played
+unsigned char * pairPoints = NULL;	// points of engine 1 in the pair, times two (0..4)
+int penta[ 5 ];						// complete pairs by points times two
+int sprt = FALSE, stop = FALSE;
+double elo0, elo1, alpha = 0.05, beta = 0.05;
+double llr = 0;
+
+/**********************************************************/
+double seconds( struct timespec * t0, struct timespec * t1 )
+{
+	return ( t1->tv_sec - t0->tv_sec ) + ( t1->tv_nsec - t0->tv_nsec ) / 1e9;
+}
+
+/**********************************************************/
+int matchRandom( unsigned int * seed )
+{
+	*seed = *seed * 1103515245 + 12345;
+	return ( *seed >> 16 ) & 0x7fff;
+}
+
+/**********************************************************/
+int listMoves( Position * pos, Move moveList[] )
+{
+	BitBoard legal = legalMoves( pos, pos->turn );
+	int n = 0, i, j;
+
+	for( i = 0; i < ARRAY_BOARD_SIZE; i++ )
+		for( j = 0; j < ARRAY_BOARD_SIZE; j++ )
+			if( bbTest( legal, BB_INDEX( i, j ) ) )
+			{
+				moveList[ n ].tile[ 0 ] = i;
+				moveList[ n ].tile[ 1 ] = j;
+				moveList[ n ].color = pos->turn;
+				n++;
+			}
+
+	return n;
+}
+
+/**********************************************************/
+int randomOpening( Position * pos, int plies, unsigned int * seed )
+{
+	/* plays plies random moves from the start, FALSE if a side has to pass on the way */
+	Move moveList[ HEX_CELLS ];
+	int n;
+
+	initPosition( pos );
+
+	while( plies-- > 0 )
+	{
+		if( ( n = listMoves( pos, moveList ) ) == 0 )
+			return FALSE;
+		doMove( pos, &moveList[ matchRandom( seed ) % n ] );
+	}
+
+	return canMove( pos, pos->turn );
+}
+
+/**********************************************************/
+void pairOpening( int pair, Position * pos )
+{
+	/* the opening of a pair of games, random ones only depend on the seed and the pair */
+	unsigned int seed;
+
+	if( openingCount > 0 )
+	{
+		*pos = openings[ pair % openingCount ];
+		return;
+	}
+
+	seed = matchSeed ^ ( ( unsigned int ) pair * 2654435761u );
+	while( !randomOpening( pos, openingPlies, &seed ) )
+		;
+}
+
+/**********************************************************/
+int parseOpening( char * line, Position * pos )
+{
+	int i, j;
+	char * p = line;
+
+	initPosition( pos );
+
+	for( i = 0; i < ARRAY_BOARD_SIZE; i++ )
+		for( j = 0; j < ARRAY_BOARD_SIZE; j++ )
+		{
+			if( pos->board[ i ][ j ] == OUT_OF_BOUND )
+				continue;
+			switch( *p++ )
+			{
+				case 'w': pos->board[ i ][ j ] = WHITE; break;
+				case 'b': pos->board[ i ][ j ] = BLACK; break;
+				case '.': pos->board[ i ][ j ] = EMPTY; break;
+				default: return FALSE;
+			}
+		}
+
+	while( *p == ' ' ) p++;
+	if( *p != 'w' && *p != 'b' )
+		return FALSE;
+	pos->turn = ( *p == 'w' ) ? WHITE : BLACK;
+
+	syncPosition( pos );
+	return TRUE;
+}
+
+/**********************************************************/
+int loadOpenings( char * fileName )
+{
+	FILE * f;
+	char line[ 2 * HEX_CELLS + 64 ];
+	int lineNumber = 0;
+
+	if( ( f = fopen( fileName, "r" ) ) == NULL )
+	{
+		printf( "ERROR: Cannot open %s\n", fileName );
+		return -1;
+	}
+
+	if( ( openings = malloc( sizeof( Position ) * MAX_OPENINGS ) ) == NULL )
+	{
+		printf( "ERROR: Out of memory\n" );
+		fclose( f );
+		return -1;
+	}
+
+	while( openingCount < MAX_OPENINGS && fgets( line, sizeof( line ), f ) != NULL )
+	{
+		lineNumber++;
+		if( line[ 0 ] == '\n' || line[ 0 ] == '#' )
+			continue;
+		if( !parseOpening( line, &openings[ openingCount ] ) )
+		{
+			printf( "ERROR: %s:%d is not a position\n", fileName, lineNumber );
+			fclose( f );
+			return -1;
+		}
+		openingCount++;
+	}
+
+	fclose( f );
+	if( openingCount == 0 )
+	{
+		printf( "ERROR: No positions in %s\n", fileName );
+		return -1;
+	}
+	return 0;
+}
+
+/**********************************************************/
+EngineLib * loadEngineLib( char * fileName, char * spec )
+{
+	/* loads another build and sets it up with spec */
+	static void * loaded[ 2 ];		//handles of the engines loaded so far
+	static int loadedCount = 0;
+	EngineLib * lib = malloc( sizeof( EngineLib ) );
+	void * handle;
+	int k;
+
+	if( lib == NULL || ( handle = dlopen( fileName, RTLD_NOW | RTLD_LOCAL ) ) == NULL )
+	{
+		printf( "ERROR: Cannot load %s (%s)\n", fileName, lib == NULL ? "out of memory" : dlerror() );
+		return NULL;
+	}
+	for( k = 0; k < loadedCount; k++ )
+		if( loaded[ k ] == handle )
+		{
+			printf( "ERROR: %s is loaded by the other engine already, copy it to another file\n", fileName );
+			dlclose( handle );
+			return NULL;
+		}
+	if( loadedCount < 2 )
+		loaded[ loadedCount++ ] = handle;
+
+	*( void ** ) &lib->version = dlsym( handle, "hexEngineVersion" );
+	*( void ** ) &lib->radius = dlsym( handle, "hexEngineRadius" );
+	*( void ** ) &lib->init = dlsym( handle, "hexEngineInit" );
+	*( void ** ) &lib->move = dlsym( handle, "hexEngineMove" );
+	*( void ** ) &lib->nodes = dlsym( handle, "hexEngineNodes" );
+	if( lib->version == NULL || lib->radius == NULL || lib->init == NULL || lib->move == NULL || lib->nodes == NULL
+		|| lib->version() != ENGINE_LIB_VERSION )
+	{
+		printf( "ERROR: %s is not an engine build (make hexengine.so)\n", fileName );
+		return NULL;
+	}
+	if( lib->radius() != HEX_BOARD_RADIUS )
+	{
+		printf( "ERROR: %s is built for radius %d, not %d\n", fileName, lib->radius(), HEX_BOARD_RADIUS );
+		return NULL;
+	}
+	if( lib->init( spec ) < 0 )
+		return NULL;
+
+	return lib;
+}
+
+/**********************************************************/
+int setupPlayer( char * spec, Player * player )
+{
+	/* an engine of this build, or of the build in so=file with the other settings */
+	char * rest = malloc( strlen( spec ) + 1 ), * copy = strdup( spec ), * item, * save = NULL;
+	char * libFile = NULL;
+	int result;
+
+	player->depth = DEFAULT_DEPTH;
+	player->spec = spec;
+	player->lib = NULL;
+	if( rest == NULL || copy == NULL )
+	{
+		printf( "ERROR: Out of memory\n" );
+		return -1;
+	}
+
+	rest[ 0 ] = '\0';
+	for( item = strtok_r( copy, ",", &save ); item != NULL; item = strtok_r( NULL, ",", &save ) )
+		if( strncmp( item, "so=", 3 ) == 0 )
+			libFile = item + 3;
+		else
+		{
+			if( rest[ 0 ] != '\0' )
+				strcat( rest, "," );
+			strcat( rest, item );
+		}
+
+	if( libFile != NULL )
+		result = ( player->lib = loadEngineLib( libFile, rest ) ) != NULL ? 0 : -1;
+	else
+		result = parseEngine( rest, &player->engine, &player->depth );
+
+	free( rest );
+	free( copy );
+	return result;
+}
+
+/**********************************************************/
+int playGame( int game, Position * pos, int * moves, long long * libNodes )
+{
+	/* plays one game from its opening, returns the disc difference for engine 1 */
+	unsigned char record[ HEX_CELLS * 2 ][ PACKED_RECORD_BYTES ];
+	unsigned char packed[ PACKED_POSITION_BYTES ];
+	int first = game & 1;		//engine playing WHITE (engine 1 plays WHITE in even games)
+	int recorded = 0, k, diff, row, col;
+	long long before;
+	Player * player;
+	Move move;
+
+	pairOpening( game / 2, pos );
+	*moves = 0;
+	ttNewSearch();		//once a game: the threads share the table, a generation a move would age entries within a search
+
+	while( 1 )
+	{
+		if( !canMove( pos, pos->turn ) )
+		{
+			if( !canMove( pos, getOtherSide( pos->turn ) ) )
+				break;
+			move.tile[ 0 ] = NULL_MOVE;
+			move.tile[ 1 ] = NULL_MOVE;
+			move.color = pos->turn;
+			doMove( pos, &move );
+			continue;
+		}
+
+		if( dump != NULL && recorded < HEX_CELLS * 2 )
+			packPosition( pos, record[ recorded++ ] );
+
+		player = &players[ pos->turn == WHITE ? first : 1 - first ];
+		if( player->lib != NULL )
+		{
+			packPosition( pos, packed );
+			before = player->lib->nodes();
+			player->lib->move( packed, &row, &col );
+			*libNodes += player->lib->nodes() - before;
+			move.tile[ 0 ] = row;
+			move.tile[ 1 ] = col;
+			move.color = pos->turn;
+			if( row == NULL_MOVE || !isLegalMove( pos, &move ) )
+			{
+				printf( "ERROR: %s played an illegal move\n", player->spec );
+				exit( 1 );
+			}
+		}
+		else
+		{
+			setEngine( &player->engine );
+			rootSearch( pos, pos->turn, TRUE, player->depth, &move );
+		}
+		doMove( pos, &move );
+		( *moves )++;
+	}
+
+	diff = pos->score[ WHITE ] - pos->score[ BLACK ];
+
+	if( dump != NULL )
+	{
+		for( k = 0; k < recorded; k++ )
+			record[ k ][ PACKED_POSITION_BYTES ] = diff > 0 ? 2 : ( diff == 0 ? 1 : 0 );
+		pthread_mutex_lock( &matchLock );
+		if( fwrite( record, PACKED_RECORD_BYTES, recorded, dump ) != recorded )
+		{
+			printf( "ERROR: Cannot write the positions\n" );
+			exit( 1 );
+		}
+		pthread_mutex_unlock( &matchLock );
+	}
+
+	return first == 0 ? diff : -diff;
+}
+
+/**********************************************************/
+double pairStats( double * mean, double * variance )
+{
+	/* mean and variance of the pair score (0..1) over the complete pairs, returns how many there are */
+	double n = 0, x;
+	int k;
+
+	*mean = *variance = 0;
+	for( k = 0; k < 5; k++ )
+	{
+		n += penta[ k ];
+		*mean += penta[ k ] * k / 4.0;
+	}
+	if( n == 0 )
+		return 0;
+	*mean /= n;
+
+	for( k = 0; k < 5; k++ )
+	{
+		x = k / 4.0 - *mean;
+		*variance += penta[ k ] * x * x;
+	}
+	*variance /= n;
+
+	return n;
+}
+
+/**********************************************************/
+double eloScore( double elo )
+{
+	return 1 / ( 1 + pow( 10, -elo / 400 ) );
+}
+
+/**********************************************************/
+void updateTest( void )
+{
+	/*
+	 * Log-likelihood ratio of elo1 against elo0, normal approximation of the pair
+	 * scores: n * ( s1 - s0 ) * ( 2 * mean - s0 - s1 ) / ( 2 * variance )
+	 */
+	double mean, variance, n = pairStats( &mean, &variance );
+	double s0 = eloScore( elo0 ), s1 = eloScore( elo1 );
+
+	if( n == 0 || variance == 0 )
+		return;
+
+	llr = n * ( s1 - s0 ) * ( 2 * mean - s0 - s1 ) / ( 2 * variance );
+	if( llr >= log( ( 1 - beta ) / alpha ) || llr <= log( beta / ( 1 - alpha ) ) )
+		stop = TRUE;
+}
+
+/**********************************************************/
+void * matchWorker( void * arg )
+{
+	Totals mine;
+	Position pos;
+	int game, diff, moves, pair;
+	long long libNodes = 0;
+
+	memset( &mine, 0, sizeof( mine ) );
+	memset( &searchStats, 0, sizeof( searchStats ) );
+
+	while( 1 )
+	{
+		pthread_mutex_lock( &matchLock );
+		game = nextGame < games && !stop ? nextGame++ : -1;
+		pthread_mutex_unlock( &matchLock );
+		if( game < 0 )
+			break;
+
+		diff = playGame( game, &pos, &moves, &libNodes );
+
+		if( diff > 0 )
+			mine.wins++;
+		else if( diff == 0 )
+			mine.draws++;
+		else
+			mine.losses++;
+		mine.discSum += diff;
+		mine.discSquares += ( double ) diff * diff;
+		mine.moves += moves;
+
+		pthread_mutex_lock( &matchLock );
+		pair = game / 2;
+		pairPoints[ pair ] += diff > 0 ? 2 : ( diff == 0 ? 1 : 0 );
+		if( ++pairGames[ pair ] == 2 )
+		{
+			penta[ pairPoints[ pair ] ]++;
+			if( sprt && !stop )
+				updateTest();
+		}
+		if( ++gamesDone % reportEvery == 0 && gamesDone < games && !stop )
+		{
+			if( sprt )
+				printf( "%d games, LLR %.2f\n", gamesDone, llr );
+			else
+				printf( "%d/%d games\n", gamesDone, games );
+		}
+		pthread_mutex_unlock( &matchLock );
+	}
+
+	mine.nodes = searchStats.nodes + searchStats.leaves + libNodes;
+
+	pthread_mutex_lock( &matchLock );
+	totals.wins += mine.wins;
+	totals.draws += mine.draws;
+	totals.losses += mine.losses;
+	totals.discSum += mine.discSum;
+	totals.discSquares += mine.discSquares;
+	totals.nodes += mine.nodes;
+	totals.moves += mine.moves;
+	pthread_mutex_unlock( &matchLock );
+
+	return NULL;
+}
+
+/**********************************************************/
+double elo( double score )
+{
+	if( score <= 0 ) score = 1e-6;
+	if( score >= 1 ) score = 1 - 1e-6;
+	return -400 * log10( 1 / score - 1 );
+}
+
+/**********************************************************/
+void report( double elapsed )
+{
+	int n = totals.wins + totals.draws + totals.losses;
+	double score = ( totals.wins + 0.5 * totals.draws ) / n;
+	double mean = totals.discSum / n;
+	double discDeviation = sqrt( fmax( totals.discSquares / n - mean * mean, 0 ) );
+	double pairMean, pairVariance, pairs = pairStats( &pairMean, &pairVariance );
+	double margin = pairs > 0 ? 1.96 * sqrt( pairVariance / pairs ) : 0;
+
+	printf( "Engine 1 (%s) vs engine 2 (%s), %d games\n", players[ 0 ].spec, players[ 1 ].spec, n );
+	printf( "W/D/L    %d / %d / %d, score %.1f%%\n", totals.wins, totals.draws, totals.losses, 100 * score );
+	printf( "pairs    %d / %d / %d / %d / %d (0 to 2 points)\n", penta[ 0 ], penta[ 1 ], penta[ 2 ], penta[ 3 ], penta[ 4 ] );
+	if( pairs > 0 )
+		printf( "Elo      %+.1f (95%%: %+.1f .. %+.1f)\n", elo( pairMean ), elo( pairMean - margin ), elo( pairMean + margin ) );
+	if( sprt )
+		printf( "SPRT     elo0 %g elo1 %g alpha %g beta %g: LLR %.2f (%.2f, %.2f), %s\n", elo0, elo1, alpha, beta, llr,
+			log( beta / ( 1 - alpha ) ), log( ( 1 - beta ) / alpha ),
+			!stop ? "no decision" : ( llr > 0 ? "H1 accepted (better by elo1)" : "H0 accepted (not better than elo0)" ) );
+	printf( "discs    %+.2f mean, %.2f stddev, %.2f standard error\n", mean, discDeviation, discDeviation / sqrt( n ) );
+	printf( "speed    %.2f games/s, %.0f nodes/s, %.1f moves/game (%.1f s)\n", n / elapsed, totals.nodes / elapsed,
+		( double ) totals.moves / n, elapsed );
+}
+
+/**********************************************************/
+int main( int argc, char ** argv )
+{
+	char * openingsFile = NULL, * networkFile = NULL, * dumpFile = NULL;
+	char * specs[ 2 ] = { "", "" };
+	int cacheMB = EVAL_CACHE_MB, ttMB = TT_MB, pairs = 0;
+	int c, k;
+	Engine defaults;
+	Position pos;
+	pthread_t tid[ MAX_THREADS ];
+	struct timespec t0, t1;
+
+	opterr = 0;
+	while( ( c = getopt( argc, argv, "1:2:n:o:r:s:g:t:c:T:D:S:h" ) ) != -1 )
+		switch( c )
+		{
+			case 'h':
+				printf( "[-1 engine] [-2 engine] [-n network_file] [-o openings_file] [-r random_opening_plies] [-s seed] [-g pairs_of_games] [-t threads] [-c eval_cache_MB] [-T tt_MB] [-D positions_output] [-S elo0:elo1[:alpha:beta]]\n" );
+				printf( "engine: comma separated e=classic|pattern|nnue w=weights_file d=depth F (no forward pruning) L (no lazy evaluation)\n" );
+				printf( "        or so=engine_build.so with those and n=network_file c=eval_cache_MB t=tt_MB\n" );
+				return 0;
+			case '1':
+				specs[ 0 ] = optarg;
+				break;
+			case '2':
+				specs[ 1 ] = optarg;
+				break;
+			case 'n':
+				networkFile = optarg;
+				break;
+			case 'o':
+				openingsFile = optarg;
+				break;
+			case 'r':
+				openingPlies = atoi( optarg );
+				if( openingPlies < 0 ) openingPlies = 0;
+				if( openingPlies > HEX_CELLS / 2 ) openingPlies = HEX_CELLS / 2;
+				break;
+			case 's':
+				matchSeed = atoi( optarg );
+				break;
+			case 'g':
+				pairs = atoi( optarg );
+				break;
+			case 't':
+				threads = atoi( optarg );
+				if( threads < 1 ) threads = 1;
+				if( threads > MAX_THREADS ) threads = MAX_THREADS;
+				break;
+			case 'c':
+				cacheMB = atoi( optarg );
+				break;
+			case 'T':
+				ttMB = atoi( optarg );
+				break;
+			case 'D':
+				dumpFile = optarg;
+				break;
+			case 'S':
+				if( sscanf( optarg, "%lf:%lf:%lf:%lf", &elo0, &elo1, &alpha, &beta ) < 2 || elo1 <= elo0
+					|| alpha <= 0 || alpha >= 0.5 || beta <= 0 || beta >= 0.5 )
+				{
+					printf( "Bad test %s (elo0:elo1[:alpha:beta], elo0 < elo1)\n", optarg );
+					return 1;
+				}
+				sprt = TRUE;
+				break;
+			case '?':
+				if( isprint( optopt ) )
+					printf( "Unknown option or missing argument -%c\n", ( char ) optopt );
+				else
+					printf( "Unknown option character -%c\n", ( char ) optopt );
+				return 1;
+			default:
+				return 1;
+		}
+
+	if( pairs == 0 )
+		pairs = sprt ? SPRT_PAIRS : DEFAULT_PAIRS;
+	if( pairs < 1 )
+	{
+		printf( "Nothing to play (-g pairs_of_games)\n" );
+		return 1;
+	}
+	games = 2 * pairs;
+
+	initPosition( &pos );		//also sets up the tables the threads share
+	if( networkFile != NULL && loadNetwork( networkFile ) < 0 )
+		return 1;
+	if( initEvalCache( cacheMB ) < 0 || initTT( ttMB, NULL ) < 0 )
+		return 1;
+
+	getEngine( &defaults );
+	for( k = 0; k < 2; k++ )
+	{
+		setEngine( &defaults );
+		if( setupPlayer( specs[ k ], &players[ k ] ) < 0 )
+			return 1;
+	}
+	setEngine( &defaults );
+
+	if( openingsFile != NULL && loadOpenings( openingsFile ) < 0 )
+		return 1;
+
+	if( ( pairGames = calloc( pairs, 1 ) ) == NULL || ( pairPoints = calloc( pairs, 1 ) ) == NULL )
+	{
+		printf( "ERROR: Out of memory\n" );
+		return 1;
+	}
+
+	if( dumpFile != NULL && ( dump = fopen( dumpFile, "wb" ) ) == NULL )
+	{
+		printf( "ERROR: Cannot open %s\n", dumpFile );
+		return 1;
+	}
+
+	reportEvery = games / 10 > 0 ? games / 10 : 1;
+	if( sprt && reportEvery > 100 )
+		reportEvery = 100;
+	if( openingCount > 0 )
+		printf( "%s%d games from %d openings on %d threads\n", sprt ? "Up to " : "", games,
+			openingCount < pairs ? openingCount : pairs, threads );
+	else
+		printf( "%s%d games from random openings of %d plies on %d threads\n", sprt ? "Up to " : "", games, openingPlies, threads );
+
+	clock_gettime( CLOCK_MONOTONIC, &t0 );
+	for( k = 0; k < threads; k++ )
+		pthread_create( &tid[ k ], NULL, matchWorker, NULL );
+	for( k = 0; k < threads; k++ )
+		pthread_join( tid[ k ], NULL );
+	clock_gettime( CLOCK_MONOTONIC, &t1 );
+
+	if( dump != NULL && fclose( dump ) != 0 )
+	{
+		printf( "ERROR: Cannot write %s\n", dumpFile );
+		return 1;
+	}
+
+	report( seconds( &t0, &t1 ) );
+	return 0;
+}
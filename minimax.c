@@ -1,4 +1,7 @@
 #include "minimax.h"
+#include "book.h"
+#include "tt.h"
+#include "alloc.h"
 #include "move.h"
 #include "global.h"
 #include <stdio.h>
@@ -8,6 +11,15 @@
 
 #define INF 100000
 
+#define PARITY_EMPTIES (HEX_CELLS * 32 / 169)		// with this many empties or less, odd regions are ordered first (32 at radius 7)
+#define PARITY_ORDER_BONUS 100	// ordering bonus for a move into an odd region (~2 discs in the endgame)
+
+__thread SearchStats searchStats;
+
+__thread int forwardPruning = TRUE;
+__thread int searchPrefetch = TRUE;
+int pruneMargin[PRUNE_DEPTH + 1] = { 0, 1350, 625, 1475 };
+
 // A helper struct to store a move and its static evaluation.
 typedef struct {
     Move move;
@@ -29,89 +41,32 @@ int cmpMin(const void *a, const void *b) {
     return ma->eval - mb->eval;  // low eval first
 }
 
-int isFrontier(Position pos, int x, int y) {
+static int frontierSearch(Position *pos, int is_max, int alpha, int beta) {
 	/*
-	 * Helper function for evaluation determines if in current state (pos)
-	 * cell (x,y) is a frontier cell i.e. there is an empty neighbor cell 
-	 * empty, so a piece in this cell could be captured, therefore is a 
-	 * liability.
+	 *	One ply search without any pruning: the best static score of the children
+	 *	(the position itself if the side to move has no move).
 	 */
-	
-    // If the tile itself is empty, it's not a frontier piece.
-    if (pos.board[x][y] == EMPTY) return 0;
-
-    // Define the 6 possible directions in a hexagonal grid
-    int dx[] = {-1, -1, 0, 0, 1, 1};
-    int dy[] = {-1, 0, -1, 1, 0, 1};
-
-    for (int d = 0; d < 6; d++) {
-        int nx = x + dx[d];
-        int ny = y + dy[d];
-
-        // Ensure we're inside the board limits
-        if (nx >= 0 && nx < ARRAY_BOARD_SIZE && ny >= 0 && ny < ARRAY_BOARD_SIZE) {
-            if (pos.board[nx][ny] == EMPTY) {
-                return 1; // It's a frontier piece
-            }
-        }
-    }
-    return 0; // Not a frontier piece
-}
-
-
-int evaluate(Position pos){
-	/* 
-	 *	Evaluation function of current state (pos). 
-	 *	
-	 *	f(state) = W_diff * (num_of_white - num_of_black) + W_validMoves * (valid_moves_white - valid_moves_black)
-	 *				- W_frontier * (num_of_frontier_white - num_of_frontier_black)
-	 *
-	 *	Evaluation heuristics: 
-	 *		+ Numner of pieces of each player (the more the better)
-	 *		+ Number of valid moves of each player (the more the better)
-	 *		+ Number of pieces near the border (these pieces can't be captured, so the more the better)
-	 *		- Number of pieces that could be captured (frontier pieces, these are liability, the less the better() 
-	 *	
-	 *	returns an int (f(state)).
-	 */
-    
-	int pieces_diff = 0, valid_moves = 0, border_control = 0, frontier_pieces = 0, val = 0;
+    BitBoard legal = legalMoves(pos, is_max ? WHITE : BLACK);
+    int best = is_max ? -INF : INF, score, index;
+    Position new_pos;
     Move cur_move;
-	pieces_diff = pos.score[WHITE] - pos.score[BLACK];
-    for (int i = 0; i < ARRAY_BOARD_SIZE; i++){
-        // Check pieces controlling the border of the board.
-        if (pos.board[0][i] == WHITE || pos.board[i][0] == WHITE ||
-            pos.board[ARRAY_BOARD_SIZE-1][i] == WHITE || pos.board[i][ARRAY_BOARD_SIZE-1] == WHITE){
-            border_control++;
-        }
-        else if (pos.board[0][i] == BLACK || pos.board[i][0] == BLACK ||
-                 pos.board[ARRAY_BOARD_SIZE-1][i] == BLACK || pos.board[i][ARRAY_BOARD_SIZE-1] == BLACK){
-            border_control--;
-        }
-        for (int j = 0; j < ARRAY_BOARD_SIZE; j++){
-            cur_move.tile[0] = i;
-            cur_move.tile[1] = j;
 
-            // Compute the difference in pieces for each player.
-            if (pos.board[i][j] == WHITE) {
-                frontier_pieces += isFrontier(pos, i, j);
-            }
-            else if (pos.board[i][j] == BLACK){
-                frontier_pieces -= isFrontier(pos, i, j);
-            }
+    if (bbIsEmpty(legal))
+        return evaluateWindow(pos, alpha, beta);
 
-            // Check number of valid moves for each player.
-            cur_move.color = WHITE;
-            if (isLegalMove(&pos, &cur_move)) valid_moves++;
-            cur_move.color = BLACK;
-            if (isLegalMove(&pos, &cur_move)) valid_moves--;
-        }
+    cur_move.color = is_max ? WHITE : BLACK;
+    for (index = bbFirst(legal); index >= 0; bbClear(&legal, index), index = bbFirst(legal)) {
+        cur_move.tile[0] = BB_ROW(index);
+        cur_move.tile[1] = BB_COL(index);
+        memcpy(&new_pos, pos, sizeof(Position));
+        doMove(&new_pos, &cur_move);
+        score = evaluateWindow(&new_pos, alpha, beta);
+        if (is_max ? score > best : score < best)
+            best = score;
     }
-    // Assign weights to each heuristic.
-    val = 50 * pieces_diff + 3 * valid_moves + 15 * border_control - 1 * frontier_pieces;
-	return (pos.score[WHITE] + pos.score[BLACK] > 140) ? 55 * pieces_diff : val; // If it's endgame prioritize the pieces difference over others heuristics.
-}
 
+    return best;
+}
 
 int minimax(Position pos, int max_depth, int depth, int is_max, int alpha_beta, int alpha, int beta) {
 	/*
@@ -130,38 +85,102 @@ int minimax(Position pos, int max_depth, int depth, int is_max, int alpha_beta,
 
 	// Terminal condition: maximum depth or no legal moves for the current player.
    if (depth == max_depth || !canMove(&pos, !is_max)){
-        return evaluate(pos);
+        searchStats.leaves++;
+        return evaluateWindow(&pos, alpha, beta);
    }
+    searchStats.nodes++;
 
     int best = is_max ? -INF : INF;
     int score;
+    int alphaOrig = alpha, betaOrig = beta;
+    int bestIndex = TT_NO_MOVE, ttMove = TT_NO_MOVE;
     Move cur_move;
     Position new_pos;
+    TTData tt;
+
+    // Transposition table: a result of a search at least as deep ends the node if it fits the window,
+    // otherwise its best move is tried first.
+    if (ttProbe(pos.hash, &tt)) {
+        if (tt.depth >= max_depth - depth && (tt.bound == TT_EXACT || (alpha_beta
+            && ((tt.bound == TT_LOWER && tt.score >= beta) || (tt.bound == TT_UPPER && tt.score <= alpha))))) {
+            ttStats.cutoffs++;
+            return tt.score;
+        }
+        ttMove = tt.move;
+    }
+
+    // Stability cutoff: in the endgame every leaf below is scored evalWeights.endgame * (white - black)
+    // and stable discs stay where they are, so they bound the final difference.
+    if (alpha_beta && pos.score[WHITE] + pos.score[BLACK] > ENDGAME_DISCS) {
+        if (is_max) {
+            score = evalWeights.endgame * (HEX_CELLS - 2 * bbCount(stableDiscs(&pos, BLACK)));
+            if (score <= alpha) {
+                searchStats.stableCutoffs++;
+                return score;
+            }
+        } else {
+            score = evalWeights.endgame * (2 * bbCount(stableDiscs(&pos, WHITE)) - HEX_CELLS);
+            if (score >= beta) {
+                searchStats.stableCutoffs++;
+                return score;
+            }
+        }
+    }
+
+    // Futility pruning and razoring (see minimax.h): a static score that far outside the
+    // window is unlikely to come back in the few plies left.
+    int plies = max_depth - depth;
+    if (alpha_beta && forwardPruning && plies <= PRUNE_DEPTH && pos.score[WHITE] + pos.score[BLACK] <= ENDGAME_DISCS) {
+        int margin = pruneMargin[plies];
+        int staticScore = evaluateWindow(&pos, is_max ? alpha - margin : beta + margin - 1,
+                                         is_max ? alpha - margin + 1 : beta + margin);
+
+        if (is_max ? staticScore + margin <= alpha : staticScore - margin >= beta) {
+            if (plies == 1) {
+                searchStats.futilityPrunes++;
+                return is_max ? staticScore + margin : staticScore - margin;
+            }
+
+            searchStats.razorSearches++;
+            margin = pruneMargin[plies - 1];
+            score = frontierSearch(&pos, is_max, alpha - margin, beta + margin);
+            if (is_max ? score + margin <= alpha : score - margin >= beta) {
+                searchStats.razorPrunes++;
+                return is_max ? score + margin : score - margin;
+            }
+        }
+    }
 
     // First, gather all legal moves for this node.
     // We allocate an array to hold moves. Worst case: all squares are legal.
-    MoveScore moves[ARRAY_BOARD_SIZE * ARRAY_BOARD_SIZE];
+    MoveScore moves[HEX_CELLS];
+    Move children[HEX_CELLS];
+    int scores[HEX_CELLS];
     int moveCount = 0;
+    // Near the end, playing into odd empty regions first usually wins the last move there.
+    int useParity = HEX_CELLS - pos.score[WHITE] - pos.score[BLACK] <= PARITY_EMPTIES;
+    BitBoard legal = legalMoves(&pos, is_max ? WHITE : BLACK);
 
     for (int i = 0; i < ARRAY_BOARD_SIZE; i++) {
         for (int j = 0; j < ARRAY_BOARD_SIZE; j++) {
-            if (pos.board[i][j] == EMPTY) {
-                cur_move.tile[0] = i;
-                cur_move.tile[1] = j;
-                cur_move.color = is_max ? WHITE : BLACK;
-                if (isLegalMove(&pos, &cur_move)) {
-                    // Create a copy of pos and apply the move.
-                    memcpy(&new_pos, &pos, sizeof(Position));
-                    doMove(&new_pos, &cur_move);
-                    // Store the move and its evaluation (static ordering).
-                    moves[moveCount].move = cur_move;
-                    moves[moveCount].eval = evaluate(new_pos);
-                    moveCount++;
-                }
+            if (bbTest(legal, BB_INDEX(i, j))) {
+                children[moveCount].tile[0] = i;
+                children[moveCount].tile[1] = j;
+                children[moveCount].color = is_max ? WHITE : BLACK;
+                moveCount++;
             }
         }
     }
 
+    // Static ordering: all children are scored in one batch, without making the moves.
+    evaluateChildren(&pos, children, moveCount, scores);
+    for (int m = 0; m < moveCount; m++) {
+        moves[m].move = children[m];
+        moves[m].eval = scores[m];
+        if (useParity && bbTest(pos.oddEmpties, BB_INDEX(children[m].tile[0], children[m].tile[1])))
+            moves[m].eval += is_max ? PARITY_ORDER_BONUS : -PARITY_ORDER_BONUS;
+    }
+
 	
 
     // Sort moves so that the best ones are expanded first.
@@ -170,6 +189,16 @@ int minimax(Position pos, int max_depth, int depth, int is_max, int alpha_beta,
 	}else{
         qsort(moves, moveCount, sizeof(MoveScore), cmpMin);
 	}
+
+    // The best move of an earlier search goes before all of them.
+    for (int m = 1; m < moveCount && ttMove != TT_NO_MOVE; m++) {
+        if (moves[m].move.tile[0] * ARRAY_BOARD_SIZE + moves[m].move.tile[1] == ttMove) {
+            MoveScore first = moves[m];
+            memmove(&moves[1], &moves[0], m * sizeof(MoveScore));
+            moves[0] = first;
+            break;
+        }
+    }
 	
 
     // Now, iterate over the sorted moves.
@@ -177,26 +206,94 @@ int minimax(Position pos, int max_depth, int depth, int is_max, int alpha_beta,
         cur_move = moves[m].move;
         memcpy(&new_pos, &pos, sizeof(Position));
         doMove(&new_pos, &cur_move);
+        // The child probes the table (or the evaluation cache at the horizon) after its move
+        // generation, so its entry can be on the way meanwhile.
+        if (searchPrefetch) {
+            if (depth + 1 < max_depth)
+                ttPrefetch(new_pos.hash);
+            else
+                evalPrefetch(new_pos.hash);
+        }
 
         score = minimax(new_pos, max_depth, depth + 1, !is_max, alpha_beta, alpha, beta);
 		
 		if (is_max) {
-            if (score > best)
+            if (score > best) {
                 best = score;
+                bestIndex = cur_move.tile[0] * ARRAY_BOARD_SIZE + cur_move.tile[1];
+            }
             if (alpha_beta) {
                 if (best > alpha)
                     alpha = best;
-                if (alpha >= beta)
+                if (alpha >= beta) {
+                    searchStats.cutoffs++;
+                    searchStats.firstCutoffs += (m == 0);
                     break; // Beta cutoff.
+                }
             }
         } else {
-            if (score < best)
+            if (score < best) {
                 best = score;
+                bestIndex = cur_move.tile[0] * ARRAY_BOARD_SIZE + cur_move.tile[1];
+            }
             if (alpha_beta) {
                 if (best < beta)
                     beta = best;
-                if (alpha >= beta)
+                if (alpha >= beta) {
+                    searchStats.cutoffs++;
+                    searchStats.firstCutoffs += (m == 0);
                     break; // Alpha cutoff.
+                }
+            }
+        }
+    }
+
+    ttStore(pos.hash, best, bestIndex, max_depth - depth,
+            best <= alphaOrig ? TT_UPPER : (best >= betaOrig ? TT_LOWER : TT_EXACT));
+    return best;
+}
+
+int rootSearch(Position *pos, int player, int alphaBeta, int depth, Move *bestMove) {
+	/*
+	 *	Searches every legal move of player (the side to move in pos) with minimax() to
+	 *	max_depth = depth and stores the best one in bestMove (NULL_MOVE if there is none).
+	 *	With alpha-beta the best score so far bounds the window of the next move: a move
+	 *	that can not beat it only needs to be shown no better (a bound, not its score).
+	 *
+	 *	Returns the score of the best move (WHITE maximizes).
+	 */
+    int best = (player == WHITE) ? -INF : INF;
+    int score;
+    Move cur_move;
+    Position new_pos;
+    BitBoard legal = legalMoves(pos, player);
+
+    bestMove->tile[0] = NULL_MOVE;
+    bestMove->tile[1] = NULL_MOVE;
+    bestMove->color = player;
+
+    for (int i = 0; i < ARRAY_BOARD_SIZE; i++) {
+        for (int j = 0; j < ARRAY_BOARD_SIZE; j++) {
+            if (!bbTest(legal, BB_INDEX(i, j)))
+                continue;
+            cur_move.tile[0] = i;
+            cur_move.tile[1] = j;
+            cur_move.color = player;
+            memcpy(&new_pos, pos, sizeof(Position));
+            doMove(&new_pos, &cur_move); // Simulate move
+
+            // The opponent moves next, so the child is a max node only if the opponent is WHITE.
+            if (alphaBeta && player == WHITE)
+                score = minimax(new_pos, depth, 0, FALSE, alphaBeta, best, INF);
+            else if (alphaBeta)
+                score = minimax(new_pos, depth, 0, TRUE, alphaBeta, -INF, best);
+            else
+                score = minimax(new_pos, depth, 0, player == BLACK, alphaBeta, -INF, INF);
+
+            if ((player == WHITE && score > best) || (player == BLACK && score < best)) {
+                best = score;
+                bestMove->tile[0] = cur_move.tile[0];
+                bestMove->tile[1] = cur_move.tile[1];
             }
         }
     }
@@ -209,57 +306,42 @@ Move getBestMove(Position pos, int player, int alphaBeta) {
 	 *	Function takes as arguments the current position (Position), current player (int - color),
 	 *	alpha_beta (int: 1 -> alpha-beta pruning, 0 -> WITHOUT alpha-beta pruning) and returns
 	 *	the best move (Move) for the current position of the game.
+	 *
+	 *	Iterative deepening: each finished depth replaces the best move of the previous one.
+	 *	Positions in the opening book (see book.h) are answered from it without a search.
 	 */
 
-    Move bestMove;
+    Move bestMove, cur_move;
     bestMove.tile[0] = NULL_MOVE;
     bestMove.tile[1] = NULL_MOVE;
     bestMove.color = player;
 
-    int best = (player == WHITE) ? -INF : INF;
-    int score, d=6, hasValidMove = 0;
+    int score, d=6;
 	double start_time = clock();
-    Move cur_move;
-    Position new_pos;
 
     // If no legal moves, return the NULL_MOVE.
     if (!canMove(&pos, player)){
         return bestMove;
 	}
 
+    if (pos.turn == player && bookProbe(&pos, &cur_move)){
+        printf("\nBook move (%d, %d)\n", cur_move.tile[0], cur_move.tile[1]);
+        return cur_move;
+    }
 
+	ttNewSearch();
 	do{
-    // Iterate over all legal moves (you could also apply move ordering here too)
-    for (int i = 0; i < ARRAY_BOARD_SIZE; i++) {
-        for (int j = 0; j < ARRAY_BOARD_SIZE; j++) {
-            cur_move.tile[0] = i;
-            cur_move.tile[1] = j;
-            cur_move.color = player;
-            if (pos.board[i][j] == EMPTY && isLegalMove(&pos, &cur_move)) {
-				hasValidMove = 1;
-                memcpy(&new_pos, &pos, sizeof(Position));
-                doMove(&new_pos, &cur_move); // Simulate move
-				
-                if (alphaBeta){
-                    score = minimax(new_pos, d, 0, player == WHITE, TRUE, -INF, INF);
-				}else{
-                    score = minimax(new_pos, d, 0, player == WHITE, FALSE, -INF, INF);
-				}
-
-				 printf("Move (%d, %d) -> Score: %d\n", i, j, score);
-
-                if ((player == WHITE && score > best) || (player == BLACK && score < best)) {
-                    best = score;
-                    bestMove.tile[0] = cur_move.tile[0];
-                    bestMove.tile[1] = cur_move.tile[1];
-                }
-            }
-        }
-    }
-	printf("\nMax depth = %d", d);
-	d++;
+        score = rootSearch(&pos, player, alphaBeta, d, &cur_move);
+        bestMove = cur_move;
+        printf("\nMax depth = %d: move (%d, %d) -> Score: %d", d, bestMove.tile[0], bestMove.tile[1], score);
+        d++;
 	}while(((double) clock() - start_time)/CLOCKS_PER_SEC < TIME_LIMIT);
-	if (!hasValidMove)  printf("ERROR: No valid moves found, but function should have found one!\n");
+    printf("\n");
+    if (evalCacheBytes() > 0)
+        printf("Eval cache: %lld / %lld hits (%.1f%%), %zu KB\n", evalStats.hits, evalStats.probes,
+               evalStats.probes ? 100.0 * evalStats.hits / evalStats.probes : 0.0, evalCacheBytes() >> 10);
+    if (ttBytes() > 0)
+        printf("Transposition table: %lld / %lld hits, %lld cutoffs, %zu MB on %s pages\n", ttStats.hits, ttStats.probes,
+               ttStats.cutoffs, ttBytes() >> 20, pagesName(ttPages));
     return bestMove;
 }
-
@@ -2,10 +2,47 @@
 #define MINIMAX_H
 
 #include "board.h"
+#include "eval.h"
 
 
 #define TIME_LIMIT 7
 
+/* Search statistics, they only grow (reset them before measuring) */
+typedef struct
+{
+	long long nodes;			// interior nodes
+	long long leaves;			// evaluate() calls at the horizon or at positions where the side to move cannot move
+	long long cutoffs;			// alpha-beta cutoffs
+	long long firstCutoffs;		// cutoffs by the first (best ordered) move
+	long long stableCutoffs;	// endgame nodes cut by the stable-disc bound
+	long long futilityPrunes;	// frontier nodes cut by futility pruning
+	long long razorSearches;	// nodes verified with a frontier search for razoring
+	long long razorPrunes;		// nodes cut by razoring
+} SearchStats;
+
+extern __thread SearchStats searchStats;	// per thread
+
+/*
+ * Forward pruning in the last PRUNE_DEPTH plies (not in the disc-count endgame):
+ *	futility	one ply left and the static score is more than pruneMargin[ 1 ] outside the window: the node is cut
+ *	razoring	2..PRUNE_DEPTH plies left and the static score is more than pruneMargin[ plies ] outside the window:
+ *				a one ply search must confirm it (by pruneMargin[ plies - 1 ]) before the node is cut
+ * Margins are in evaluation units, the 95th percentile (rounded up) of how far a search of that
+ * many plies moves away from the static score (classic evaluation, measure with bench -m).
+ */
+#define PRUNE_DEPTH 3
+
+extern __thread int forwardPruning;						// TRUE: futility pruning and razoring (default)
+extern int pruneMargin[PRUNE_DEPTH + 1];		// by plies left, [0] is not used
+
+extern __thread int searchPrefetch;						// TRUE: prefetch the table entry of a child when its move is made (default)
+
+int minimax(Position pos, int max_depth, int depth, int is_max, int alpha_beta, int alpha, int beta);
+// score of pos searched max_depth - depth plies (WHITE maximizes, is_max: WHITE to move)
+
+int rootSearch(Position *pos, int player, int alphaBeta, int depth, Move *bestMove);
+// one iteration: best move of player with the children searched to depth, returns its score
+
 Move getBestMove(Position pos, int player, int alpheBeta);
 
 #endif
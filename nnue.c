@@ -0,0 +1,153 @@
+#include "nnue.h"
+#include "bitboard.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined( __x86_64__ ) && defined( __GNUC__ ) && NNUE_HIDDEN % 16 == 0
+#define NNUE_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+#define NNUE_FILE_MAGIC 0x4E4E5848		//"HXNN"
+#define NNUE_FILE_VERSION 1
+
+/**********************************************************/
+int nnueEnabled = FALSE;
+short nnueCell[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ];
+short nnueHiddenWeights[ NNUE_INPUTS ][ NNUE_HIDDEN ];
+short nnueHiddenBias[ NNUE_HIDDEN ];
+short nnueOutputWeights[ NNUE_HIDDEN ];		//int8 in the file, widened for the int16 dot product
+int nnueOutputBias;
+int nnueShift;
+
+static int networkInitialized = FALSE;
+
+/**********************************************************/
+void initNetwork( void )
+{
+	int i, j, tile = 0;
+
+	if( networkInitialized )
+		return;
+
+	initBitBoards();
+
+	for( i = 0; i < ARRAY_BOARD_SIZE; i++ )
+		for( j = 0; j < ARRAY_BOARD_SIZE; j++ )
+			nnueCell[ i ][ j ] = bbTest( bbValid, BB_INDEX( i, j ) ) ? 2 * tile++ : -1;
+
+	networkInitialized = TRUE;
+}
+
+/**********************************************************/
+int loadNetwork( char * fileName )
+{
+	FILE * f;
+	int header[ 6 ], k;
+	signed char output[ NNUE_HIDDEN ];
+
+	initNetwork();
+
+	if( ( f = fopen( fileName, "rb" ) ) == NULL )
+	{
+		printf( "ERROR: Cannot open network %s\n", fileName );
+		return -1;
+	}
+
+	if( fread( header, sizeof( int ), 6, f ) != 6 || header[ 0 ] != NNUE_FILE_MAGIC || header[ 1 ] != NNUE_FILE_VERSION
+		|| header[ 2 ] != HEX_BOARD_RADIUS || header[ 3 ] != NNUE_INPUTS || header[ 4 ] != NNUE_HIDDEN
+		|| header[ 5 ] < 0 || header[ 5 ] > 30 )
+	{
+		printf( "ERROR: %s is not a network for this board\n", fileName );
+		fclose( f );
+		return -1;
+	}
+
+	if( fread( nnueHiddenBias, sizeof( short ), NNUE_HIDDEN, f ) != NNUE_HIDDEN
+		|| fread( nnueHiddenWeights, sizeof( short ), NNUE_INPUTS * NNUE_HIDDEN, f ) != NNUE_INPUTS * NNUE_HIDDEN
+		|| fread( output, 1, NNUE_HIDDEN, f ) != NNUE_HIDDEN
+		|| fread( &nnueOutputBias, sizeof( int ), 1, f ) != 1 )
+	{
+		printf( "ERROR: %s is truncated\n", fileName );
+		nnueEnabled = FALSE;
+		fclose( f );
+		return -1;
+	}
+
+	for( k = 0; k < NNUE_HIDDEN; k++ )
+		nnueOutputWeights[ k ] = output[ k ];
+	nnueShift = header[ 5 ];
+	nnueEnabled = TRUE;
+
+	fclose( f );
+	return 0;
+}
+
+/**********************************************************/
+void nnueRefresh( char board[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ], short acc[ NNUE_HIDDEN ] )
+{
+	int i, j;
+
+	initNetwork();
+	memcpy( acc, nnueHiddenBias, sizeof( nnueHiddenBias ) );
+
+	for( i = 0; i < ARRAY_BOARD_SIZE; i++ )
+		for( j = 0; j < ARRAY_BOARD_SIZE; j++ )
+			if( nnueCell[ i ][ j ] >= 0 && ( board[ i ][ j ] == WHITE || board[ i ][ j ] == BLACK ) )
+				nnueAdd( acc, i, j, board[ i ][ j ] );
+}
+
+/**********************************************************/
+static int outputScalar( short acc[ NNUE_HIDDEN ] )
+{
+	int k, v, sum = 0;
+
+	for( k = 0; k < NNUE_HIDDEN; k++ )
+	{
+		v = acc[ k ] < 0 ? 0 : ( acc[ k ] > NNUE_CLAMP ? NNUE_CLAMP : acc[ k ] );
+		sum += v * nnueOutputWeights[ k ];
+	}
+
+	return sum;
+}
+
+#ifdef NNUE_AVX2_KERNEL
+/**********************************************************/
+__attribute__( ( target( "avx2" ) ) ) static int outputAVX2( short acc[ NNUE_HIDDEN ] )
+{
+	/* clip 16 neurons at a time, multiply-add pairs into int32 lanes, add the lanes at the end */
+	__m256i zero = _mm256_setzero_si256(), clamp = _mm256_set1_epi16( NNUE_CLAMP );
+	__m256i sum = _mm256_setzero_si256(), a, w;
+	__m128i s;
+	int k;
+
+	for( k = 0; k < NNUE_HIDDEN; k += 16 )
+	{
+		a = _mm256_loadu_si256( ( __m256i * ) &acc[ k ] );
+		a = _mm256_min_epi16( _mm256_max_epi16( a, zero ), clamp );
+		w = _mm256_loadu_si256( ( __m256i * ) &nnueOutputWeights[ k ] );
+		sum = _mm256_add_epi32( sum, _mm256_madd_epi16( a, w ) );
+	}
+
+	s = _mm_add_epi32( _mm256_castsi256_si128( sum ), _mm256_extracti128_si256( sum, 1 ) );
+	s = _mm_add_epi32( s, _mm_shuffle_epi32( s, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	s = _mm_add_epi32( s, _mm_shuffle_epi32( s, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	return _mm_cvtsi128_si32( s );
+}
+#endif
+
+/**********************************************************/
+int nnueEvaluate( short acc[ NNUE_HIDDEN ] )
+{
+	int sum;
+
+#ifdef NNUE_AVX2_KERNEL
+	if( bbHasAVX2 )
+		sum = outputAVX2( acc );
+	else
+#endif
+		sum = outputScalar( acc );
+
+	return ( sum + nnueOutputBias ) >> nnueShift;
+}
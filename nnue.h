@@ -0,0 +1,75 @@
+#ifndef _NNUE_H
+#define _NNUE_H
+
+#include "global.h"
+
+/**********************************************************/
+
+/*
+Network evaluation (NNUE style):
+
+	inputs		one per (tile, color): input 2 * tile + color is 1 if the tile holds a disc of that color,
+				tiles are the playable tiles numbered row by row
+	hidden		NNUE_HIDDEN int16 neurons, clipped ReLU to [ 0, NNUE_CLAMP ]
+	output		int8 weights, ( dot product + bias ) >> shift (positive is good for WHITE)
+
+The hidden layer before the activation (the accumulator) is a sum of the weight
+columns of the discs on the board, so doMove() keeps it up to date by adding the
+column of the new disc and swapping the columns of each flipped one. Undo is free
+because positions are copied (copy-make).
+
+Weights file (native byte order):
+	int header[ 6 ] = { NNUE_FILE_MAGIC, NNUE_FILE_VERSION, HEX_BOARD_RADIUS, NNUE_INPUTS, NNUE_HIDDEN, shift }
+	int16 hidden bias[ NNUE_HIDDEN ]
+	int16 hidden weights[ NNUE_INPUTS ][ NNUE_HIDDEN ]
+	int8 output weights[ NNUE_HIDDEN ]
+	int32 output bias
+*/
+#define NNUE_INPUTS ( 2 * HEX_CELLS )
+#define NNUE_HIDDEN 64
+#define NNUE_CLAMP 127
+
+/**********************************************************/
+extern int nnueEnabled;											//TRUE once a network is loaded, doMove() updates accumulators only then
+extern short nnueCell[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ];		//first input of each tile (2 * tile number), -1 if not playable
+extern short nnueHiddenWeights[ NNUE_INPUTS ][ NNUE_HIDDEN ];
+extern short nnueHiddenBias[ NNUE_HIDDEN ];
+extern short nnueOutputWeights[ NNUE_HIDDEN ];
+extern int nnueOutputBias;
+extern int nnueShift;
+/**********************************************************/
+
+void initNetwork( void );
+//numbers the tiles (safe to call more than once)
+
+int loadNetwork( char * fileName );
+//loads a weights file and enables the network, returns 0 on success and -1 on failure
+
+void nnueRefresh( char board[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ], short acc[ NNUE_HIDDEN ] );
+//computes the accumulator from scratch
+
+int nnueEvaluate( short acc[ NNUE_HIDDEN ] );
+//output of the network for an accumulator (AVX2 if the cpu supports it)
+
+
+/**********************************************************/
+static inline void nnueAdd( short acc[ NNUE_HIDDEN ], int row, int col, int color )
+{
+	/* a disc of color was put on (row, col) */
+	short * w = nnueHiddenWeights[ nnueCell[ row ][ col ] + color ];
+	int k;
+	for( k = 0; k < NNUE_HIDDEN; k++ )
+		acc[ k ] += w[ k ];
+}
+
+static inline void nnueFlip( short acc[ NNUE_HIDDEN ], int row, int col, int from, int to )
+{
+	/* the disc on (row, col) changed from color from to color to */
+	short * add = nnueHiddenWeights[ nnueCell[ row ][ col ] + to ];
+	short * sub = nnueHiddenWeights[ nnueCell[ row ][ col ] + from ];
+	int k;
+	for( k = 0; k < NNUE_HIDDEN; k++ )
+		acc[ k ] += add[ k ] - sub[ k ];
+}
+
+#endif
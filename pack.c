@@ -0,0 +1,95 @@
+#include "pack.h"
+
+/* tile code -> board value */
+static const char codeTile[ 4 ] = { EMPTY, WHITE, BLACK, ILLEGAL };
+
+/**********************************************************/
+static inline void rowSpan( int row, int * first, int * length )
+{
+	/* playable columns of a row: HEX_BOARD_RADIUS <= row + col <= 3 * HEX_BOARD_RADIUS */
+	int last = 3 * HEX_BOARD_RADIUS - row < 2 * HEX_BOARD_RADIUS ? 3 * HEX_BOARD_RADIUS - row : 2 * HEX_BOARD_RADIUS;
+
+	*first = HEX_BOARD_RADIUS - row > 0 ? HEX_BOARD_RADIUS - row : 0;
+	*length = last - *first + 1;
+}
+
+/**********************************************************/
+static inline uint64_t rowBits( BitBoard b, int index, int length )
+{
+	/* length ( < 32 ) bits of b from bit index on */
+	uint64_t bits = b.w[ index >> 6 ] >> ( index & 63 );
+
+	if( ( index & 63 ) + length > 64 )
+		bits |= b.w[ ( index >> 6 ) + 1 ] << ( 64 - ( index & 63 ) );
+
+	return bits & ( ( 1ULL << length ) - 1 );
+}
+
+/**********************************************************/
+static inline uint64_t spreadBits( uint64_t x )
+{
+	/* bit k of x (k < 32) to bit 2k */
+	x = ( x | ( x << 16 ) ) & 0x0000FFFF0000FFFFULL;
+	x = ( x | ( x << 8 ) ) & 0x00FF00FF00FF00FFULL;
+	x = ( x | ( x << 4 ) ) & 0x0F0F0F0F0F0F0F0FULL;
+	x = ( x | ( x << 2 ) ) & 0x3333333333333333ULL;
+	x = ( x | ( x << 1 ) ) & 0x5555555555555555ULL;
+	return x;
+}
+
+/**********************************************************/
+void packPosition( Position * pos, unsigned char out[ PACKED_POSITION_BYTES ] )
+{
+	BitBoard illegal, white, black;
+	uint64_t stream = 0;
+	int bits = 0, n = 0, row, first, length;
+
+	initBitBoards();
+
+	illegal = pos->illegal;
+	white = bbOr( pos->pieces[ WHITE ], illegal );
+	black = bbOr( pos->pieces[ BLACK ], illegal );
+
+	for( row = 0; row < ARRAY_BOARD_SIZE; row++ )
+	{
+		rowSpan( row, &first, &length );
+		stream |= ( spreadBits( rowBits( white, BB_INDEX( row, first ), length ) )
+			| ( spreadBits( rowBits( black, BB_INDEX( row, first ), length ) ) << 1 ) ) << bits;
+		bits += 2 * length;
+
+		for( ; bits >= 8; bits -= 8, stream >>= 8 )
+			out[ n++ ] = ( unsigned char ) stream;
+	}
+
+	stream |= ( uint64_t ) ( pos->turn == BLACK ) << bits;
+	for( ; n < PACKED_POSITION_BYTES; stream >>= 8 )
+		out[ n++ ] = ( unsigned char ) stream;
+}
+
+/**********************************************************/
+void unpackPosition( unsigned char in[ PACKED_POSITION_BYTES ], Position * pos )
+{
+	uint64_t stream = 0;
+	int bits = 0, n = 0, row, col, first, length;
+
+	for( row = 0; row < ARRAY_BOARD_SIZE; row++ )
+		for( col = 0; col < ARRAY_BOARD_SIZE; col++ )
+			pos->board[ row ][ col ] = OUT_OF_BOUND;
+
+	for( row = 0; row < ARRAY_BOARD_SIZE; row++ )
+	{
+		rowSpan( row, &first, &length );
+		for( ; bits < 2 * length; bits += 8 )
+			stream |= ( uint64_t ) in[ n++ ] << bits;
+
+		for( col = first; col < first + length; col++, stream >>= 2 )
+			pos->board[ row ][ col ] = codeTile[ stream & 3 ];
+		bits -= 2 * length;
+	}
+
+	if( bits == 0 )
+		stream = in[ n ];
+	pos->turn = ( stream & 1 ) ? BLACK : WHITE;
+
+	syncPosition( pos );
+}
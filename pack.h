@@ -0,0 +1,33 @@
+#ifndef _PACK_H
+#define _PACK_H
+
+#include "global.h"
+#include "board.h"
+
+/**********************************************************/
+
+/*
+Packed positions:
+
+Two bits per tile of the hexagon, tiles row by row, then one bit for the side
+to move, as a little-endian bit stream (43 bytes at radius 7 instead of the
+228 bytes of sendPosition()). Tile codes:
+	0 EMPTY		1 WHITE		2 BLACK		3 ILLEGAL
+so bit 0 of a tile is the WHITE bitboard and bit 1 the BLACK one. Packing
+works one board row at a time straight from the bitboards.
+
+Training records (tuner -p) are a packed position followed by one byte,
+the result for WHITE times two (0, 1 or 2).
+*/
+#define PACKED_POSITION_BYTES ( ( 2 * HEX_CELLS + 1 + 7 ) / 8 )
+#define PACKED_RECORD_BYTES ( PACKED_POSITION_BYTES + 1 )
+
+/**********************************************************/
+
+void packPosition( Position * pos, unsigned char out[ PACKED_POSITION_BYTES ] );
+//packs pos (its bitboards must be in sync, as after doMove() or syncPosition())
+
+void unpackPosition( unsigned char in[ PACKED_POSITION_BYTES ], Position * pos );
+//rebuilds a whole position (board, turn and everything syncPosition() computes)
+
+#endif
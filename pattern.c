@@ -0,0 +1,296 @@
+#include "pattern.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PATTERN_FILE_MAGIC 0x54505848		//"HXPT"
+#define PATTERN_FILE_VERSION 1
+
+/**********************************************************/
+int patternType[ PATTERN_INSTANCES ];
+int patternTiles[ PATTERN_TYPES ];
+int patternOffset[ PATTERN_TYPES ];
+int patternTableSize;
+__thread short * patternWeights = NULL;
+signed char patternInstanceRow[ PATTERN_INSTANCES ][ PATTERN_MAX_TILES ];
+signed char patternInstanceCol[ PATTERN_INSTANCES ][ PATTERN_MAX_TILES ];
+
+unsigned char patternRefCount[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ];
+unsigned char patternRefInstance[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ][ PATTERN_TILE_REFS ];
+unsigned short patternRefPower[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ][ PATTERN_TILE_REFS ];
+
+static int patternsInitialized = FALSE;
+
+/**********************************************************/
+static void rotate60( int * row, int * col )
+{
+	/* axial coordinates around the centre: (q, r) -> (-r, q + r) */
+	int q = *col - HEX_BOARD_RADIUS;
+	int r = *row - HEX_BOARD_RADIUS;
+
+	*col = -r + HEX_BOARD_RADIUS;
+	*row = q + r + HEX_BOARD_RADIUS;
+}
+
+/**********************************************************/
+static int hexDistance( int row1, int col1, int row2, int col2 )
+{
+	int dq = col1 - col2, dr = row1 - row2;
+
+	return ( abs( dq ) + abs( dr ) + abs( dq + dr ) ) / 2;
+}
+
+/**********************************************************/
+static int tileValue( int row, int col )
+{
+	/* seed value of a disc on a tile, in the units of the classic evaluation */
+	int corner, r = HEX_BOARD_RADIUS, i, cr = 0, cc = r;
+	int ring = hexDistance( row, col, r, r );
+	int toCorner = 2 * r;
+
+	for( corner = 0; corner < 6; corner++ )
+	{
+		i = hexDistance( row, col, cr, cc );
+		if( i < toCorner )
+			toCorner = i;
+		rotate60( &cr, &cc );
+	}
+
+	if( toCorner == 0 )
+		return 300;			//corner
+	if( toCorner == 1 )
+		return ( ring == r ) ? -80 : -150;	//next to a corner, along an edge or inwards
+	if( ring == r )
+		return 60;			//edge
+	if( ring == r - 1 )
+		return -10;			//gives the edge away
+	return 20;
+}
+
+/**********************************************************/
+static void addInstance( int instance, int type, int tiles, int row[], int col[] )
+{
+	int k, power = 1;
+
+	patternType[ instance ] = type;
+	patternTiles[ type ] = tiles;
+
+	for( k = 0; k < tiles; k++ )
+	{
+		patternInstanceRow[ instance ][ k ] = row[ k ];
+		patternInstanceCol[ instance ][ k ] = col[ k ];
+
+		patternRefInstance[ row[ k ] ][ col[ k ] ][ patternRefCount[ row[ k ] ][ col[ k ] ] ] = instance;
+		patternRefPower[ row[ k ] ][ col[ k ] ][ patternRefCount[ row[ k ] ][ col[ k ] ] ] = power;
+		patternRefCount[ row[ k ] ][ col[ k ] ]++;
+		power *= 3;
+	}
+}
+
+/**********************************************************/
+static void seedWeights( void )
+{
+	/*
+	 * Until tuned weights are loaded, every entry is the sum of the tile values
+	 * of its discs, each tile value shared out between the instances covering it.
+	 */
+	int type, inst, index, k, digits, value, phase;
+
+	for( type = 0; type < PATTERN_TYPES; type++ )
+	{
+		for( inst = 0; patternType[ inst ] != type; inst++ )
+			;	//first instance of the type
+
+		for( index = 0, digits = 1; digits <= patternTiles[ type ]; digits++ )
+			index = index * 3 + 2;	//largest index
+
+		for( ; index >= 0; index-- )
+		{
+			value = 0;
+			for( k = 0, digits = index; k < patternTiles[ type ]; k++, digits /= 3 )
+			{
+				int row = patternInstanceRow[ inst ][ k ], col = patternInstanceCol[ inst ][ k ];
+				int v = tileValue( row, col ) / patternRefCount[ row ][ col ];
+
+				if( digits % 3 == WHITE + 1 )
+					value += v;
+				else if( digits % 3 == BLACK + 1 )
+					value -= v;
+			}
+
+			for( phase = 0; phase < PATTERN_PHASES; phase++ )
+				patternWeights[ phase * patternTableSize + patternOffset[ type ] + index ] = value;
+		}
+	}
+}
+
+/**********************************************************/
+void initPatterns( void )
+{
+	int row[ PATTERN_MAX_TILES ], col[ PATTERN_MAX_TILES ];
+	int r = HEX_BOARD_RADIUS;
+	int type, rot, k, n, size, instance = 0;
+
+	if( patternsInitialized )
+		return;
+
+	memset( patternRefCount, 0, sizeof( patternRefCount ) );
+
+	for( type = 0; type < PATTERN_TYPES; type++ )
+	{
+		/* prototype instance at the top corner (0, r) / top edge */
+		n = 0;
+		switch( type )
+		{
+			case PATTERN_EDGE:
+				for( k = r; k <= 2 * r; k++, n++ ) { row[ n ] = 0; col[ n ] = k; }
+				break;
+			case PATTERN_EDGE2:
+				for( k = r - 1; k <= 2 * r; k++, n++ ) { row[ n ] = 1; col[ n ] = k; }
+				break;
+			case PATTERN_CORNER:
+				row[ 0 ] = 0; col[ 0 ] = r;
+				row[ 1 ] = 0; col[ 1 ] = r + 1;
+				row[ 2 ] = 0; col[ 2 ] = r + 2;
+				row[ 3 ] = 1; col[ 3 ] = r - 1;
+				row[ 4 ] = 2; col[ 4 ] = r - 2;
+				row[ 5 ] = 1; col[ 5 ] = r;
+				row[ 6 ] = 1; col[ 6 ] = r + 1;
+				row[ 7 ] = 2; col[ 7 ] = r - 1;
+				n = 8;
+				break;
+			case PATTERN_AXIS:
+				for( k = 0; k <= r; k++, n++ ) { row[ n ] = k; col[ n ] = r; }
+				break;
+			case PATTERN_CENTER:
+				row[ 0 ] = r; col[ 0 ] = r;
+				row[ 1 ] = r - 1; col[ 1 ] = r;
+				for( k = 2; k < 7; k++ )
+				{
+					row[ k ] = row[ k - 1 ];
+					col[ k ] = col[ k - 1 ];
+					rotate60( &row[ k ], &col[ k ] );
+				}
+				n = 7;
+				break;
+		}
+
+		/* the six rotations (the centre is symmetric, one instance is enough) */
+		for( rot = 0; rot < ( type == PATTERN_CENTER ? 1 : 6 ); rot++ )
+		{
+			addInstance( instance++, type, n, row, col );
+			for( k = 0; k < n; k++ )
+				rotate60( &row[ k ], &col[ k ] );
+		}
+	}
+
+	/* table layout */
+	patternTableSize = 0;
+	for( type = 0; type < PATTERN_TYPES; type++ )
+	{
+		patternOffset[ type ] = patternTableSize;
+		for( k = 0, size = 1; k < patternTiles[ type ]; k++ )
+			size *= 3;
+		patternTableSize += size;
+	}
+
+	patternWeights = malloc( sizeof( short ) * PATTERN_PHASES * patternTableSize );
+	if( patternWeights == NULL )
+	{
+		printf( "ERROR: Out of memory (initPatterns)\n" );
+		exit( 1 );
+	}
+
+	seedWeights();
+
+	patternsInitialized = TRUE;
+}
+
+/**********************************************************/
+void computePatternIndices( char board[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ], unsigned short index[ PATTERN_INSTANCES ] )
+{
+	int inst, k;
+
+	for( inst = 0; inst < PATTERN_INSTANCES; inst++ )
+	{
+		index[ inst ] = 0;
+		for( k = patternTiles[ patternType[ inst ] ] - 1; k >= 0; k-- )
+		{
+			char tile = board[ (int) patternInstanceRow[ inst ][ k ] ][ (int) patternInstanceCol[ inst ][ k ] ];
+			index[ inst ] = index[ inst ] * 3 + ( ( tile == WHITE || tile == BLACK ) ? tile + 1 : 0 );
+		}
+	}
+}
+
+/**********************************************************/
+int patternEvaluate( unsigned short index[ PATTERN_INSTANCES ], int empties )
+{
+	short * table = patternWeights + PATTERN_PHASE( empties ) * patternTableSize;
+	int inst, val = 0;
+
+	for( inst = 0; inst < PATTERN_INSTANCES; inst++ )
+		val += table[ patternOffset[ patternType[ inst ] ] + index[ inst ] ];
+
+	return val;
+}
+
+/**********************************************************/
+int loadPatternWeights( char * fileName )
+{
+	FILE * f;
+	int header[ 5 ];
+
+	initPatterns();
+
+	if( ( f = fopen( fileName, "rb" ) ) == NULL )
+	{
+		printf( "ERROR: Cannot open pattern weights %s\n", fileName );
+		return -1;
+	}
+
+	if( fread( header, sizeof( int ), 5, f ) != 5 || header[ 0 ] != PATTERN_FILE_MAGIC || header[ 1 ] != PATTERN_FILE_VERSION
+		|| header[ 2 ] != HEX_BOARD_RADIUS || header[ 3 ] != PATTERN_PHASES || header[ 4 ] != patternTableSize )
+	{
+		printf( "ERROR: %s is not a pattern weights file for this board\n", fileName );
+		fclose( f );
+		return -1;
+	}
+
+	if( fread( patternWeights, sizeof( short ), PATTERN_PHASES * patternTableSize, f ) != PATTERN_PHASES * patternTableSize )
+	{
+		printf( "ERROR: %s is truncated\n", fileName );
+		seedWeights();
+		fclose( f );
+		return -1;
+	}
+
+	fclose( f );
+	return 0;
+}
+
+/**********************************************************/
+int savePatternWeights( char * fileName )
+{
+	FILE * f;
+	int header[ 5 ] = { PATTERN_FILE_MAGIC, PATTERN_FILE_VERSION, HEX_BOARD_RADIUS, PATTERN_PHASES, 0 };
+
+	initPatterns();
+	header[ 4 ] = patternTableSize;
+
+	if( ( f = fopen( fileName, "wb" ) ) == NULL )
+	{
+		printf( "ERROR: Cannot create %s\n", fileName );
+		return -1;
+	}
+
+	if( fwrite( header, sizeof( int ), 5, f ) != 5
+		|| fwrite( patternWeights, sizeof( short ), PATTERN_PHASES * patternTableSize, f ) != PATTERN_PHASES * patternTableSize )
+	{
+		printf( "ERROR: Cannot write %s\n", fileName );
+		fclose( f );
+		return -1;
+	}
+
+	fclose( f );
+	return 0;
+}
@@ -0,0 +1,79 @@
+#ifndef _PATTERN_H
+#define _PATTERN_H
+
+#include "global.h"
+
+/**********************************************************/
+
+/*
+Pattern evaluation:
+
+A pattern is a fixed group of tiles. Each instance of a pattern is indexed
+by the base-3 number of its tiles (EMPTY = 0, WHITE = 1, BLACK = 2) and the
+index selects a weight in the table of its pattern type and game phase.
+The six rotations of the hexagon share one table per type.
+
+Types (for radius R):
+	EDGE		one of the six edges				( R + 1 tiles, 6 instances )
+	EDGE2		the line next to an edge			( R + 2 tiles, 6 instances )
+	CORNER		a corner, 2 tiles along each edge and the 3 inner tiles behind them	( 8 tiles, 6 instances )
+	AXIS		half of a main diagonal, corner to centre	( R + 1 tiles, 6 instances )
+	CENTER		the centre tile and its neighbours	( 7 tiles, 1 instance )
+
+Indices are kept up to date by doMove(), so the evaluation is PATTERN_INSTANCES table lookups.
+*/
+#define PATTERN_EDGE 0
+#define PATTERN_EDGE2 1
+#define PATTERN_CORNER 2
+#define PATTERN_AXIS 3
+#define PATTERN_CENTER 4
+#define PATTERN_TYPES 5
+
+#define PATTERN_INSTANCES ( 4 * 6 + 1 )
+#define PATTERN_MAX_TILES ( HEX_BOARD_RADIUS + 2 > 8 ? HEX_BOARD_RADIUS + 2 : 8 )
+#define PATTERN_TILE_REFS 8					//max pattern instances sharing one tile
+
+/* weights are separate per game phase, selected by the number of empty tiles */
+#define PATTERN_PHASES 8
+#define PATTERN_PHASE( empties ) ( ( empties ) * PATTERN_PHASES / ( HEX_CELLS + 1 ) )
+
+/**********************************************************/
+extern int patternType[ PATTERN_INSTANCES ];						//type of each instance
+extern int patternTiles[ PATTERN_TYPES ];							//tiles per type
+extern int patternOffset[ PATTERN_TYPES ];							//start of each type in a phase table
+extern int patternTableSize;										//entries of one phase table (all types)
+extern __thread short * patternWeights;								//[ PATTERN_PHASES ][ patternTableSize ], per thread (engine.h)
+extern signed char patternInstanceRow[ PATTERN_INSTANCES ][ PATTERN_MAX_TILES ];
+extern signed char patternInstanceCol[ PATTERN_INSTANCES ][ PATTERN_MAX_TILES ];
+
+extern unsigned char patternRefCount[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ];
+extern unsigned char patternRefInstance[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ][ PATTERN_TILE_REFS ];
+extern unsigned short patternRefPower[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ][ PATTERN_TILE_REFS ];
+/**********************************************************/
+
+void initPatterns( void );
+//builds the pattern geometry and seeds the weights (safe to call more than once)
+
+void computePatternIndices( char board[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ], unsigned short index[ PATTERN_INSTANCES ] );
+//computes every instance index from scratch
+
+int patternEvaluate( unsigned short index[ PATTERN_INSTANCES ], int empties );
+//sum of the pattern weights (positive is good for WHITE)
+
+int loadPatternWeights( char * fileName );
+//loads the weight tables from a file, returns 0 on success and -1 on failure
+
+int savePatternWeights( char * fileName );
+//writes the weight tables to a file, returns 0 on success and -1 on failure
+
+
+/**********************************************************/
+static inline void patternUpdate( unsigned short index[ PATTERN_INSTANCES ], int row, int col, int delta )
+{
+	/* delta is (new tile state - old tile state) in base-3 digits */
+	int k;
+	for( k = 0; k < patternRefCount[ row ][ col ]; k++ )
+		index[ patternRefInstance[ row ][ col ][ k ] ] += delta * patternRefPower[ row ][ col ][ k ];
+}
+
+#endif
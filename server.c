@@ -7,8 +7,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <signal.h>
 
 
+/**********************************************************/
+void stopServer( int signalNumber )
+{
+	/* interrupted (a client may never answer): no shared memory names left behind */
+	releaseSharedMemory();
+	_exit( 1 );
+}
+
 /**********************************************************/
 int main( int argc, char **argv )
 {
@@ -18,11 +27,11 @@ int main( int argc, char **argv )
 	int c;
 	opterr = 0;
 
-	while( ( c = getopt( argc, argv, "p:g:hs" ) ) != -1 )
+	while( ( c = getopt( argc, argv, "p:g:hscm" ) ) != -1 )
 		switch( c )
 		{
 			case 'h':
-				printf( "[-p port] [-g number_of_games] [-s (swap color after each game)]\n" );
+				printf( "[-p port] [-g number_of_games] [-s (swap color after each game)] [-c (send packed positions)] [-m (shared memory transport, clients on this host)]\n" );
 				return 0;
 			case 'p':
 				port = optarg;
@@ -33,6 +42,12 @@ int main( int argc, char **argv )
 			case 's':
 				swapAfterEachGame = TRUE;
 				break;
+			case 'c':
+				packedPositions = TRUE;
+				break;
+			case 'm':
+				sharedMemory = TRUE;
+				break;
 			case '?':
 				if( optopt == 'p' || optopt == 'g' )
 					printf( "Option -%c requires an argument.\n", ( char ) optopt );
@@ -52,6 +67,15 @@ int main( int argc, char **argv )
 	playerOne.playerSocket = acceptConnection( serverSocket );
 	playerTwo.playerSocket = acceptConnection( serverSocket );
 
+	//same host: the rest of the connection goes over shared memory (stays on TCP if that fails)
+	if( sharedMemory == TRUE )
+	{
+		signal( SIGINT, stopServer );
+		signal( SIGTERM, stopServer );
+		offerSharedMemory( playerOne.playerSocket );
+		offerSharedMemory( playerTwo.playerSocket );
+	}
+
 	//first who connects gets white color
 	playerOne.color = WHITE;
 	playerTwo.color = BLACK;
@@ -59,6 +83,12 @@ int main( int argc, char **argv )
 	sendMsg( NM_COLOR_W, playerOne.playerSocket );
 	sendMsg( NM_COLOR_B, playerTwo.playerSocket );
 
+	//board radius (clients are built for one radius and quit if it is not theirs)
+	sendMsg( NM_BOARD_RADIUS, playerOne.playerSocket );
+	sendMsg( HEX_BOARD_RADIUS, playerOne.playerSocket );
+	sendMsg( NM_BOARD_RADIUS, playerTwo.playerSocket );
+	sendMsg( HEX_BOARD_RADIUS, playerTwo.playerSocket );
+
 
 	//request names
 	sendMsg( NM_REQUEST_NAME, playerOne.playerSocket );
@@ -77,11 +107,16 @@ int main( int argc, char **argv )
 		printPosition( &gamePosition );
 
 		//sending position
-		sendMsg( NM_NEW_POSITION, playerOne.playerSocket );
-		sendPosition( &gamePosition, playerOne.playerSocket );
-
-		sendMsg( NM_NEW_POSITION, playerTwo.playerSocket );
-		sendPosition( &gamePosition, playerTwo.playerSocket );
+		if( packedPositions == TRUE )
+		{
+			sendMsgAndPackedPosition( NM_NEW_POSITION_PACKED, &gamePosition, playerOne.playerSocket );
+			sendMsgAndPackedPosition( NM_NEW_POSITION_PACKED, &gamePosition, playerTwo.playerSocket );
+		}
+		else
+		{
+			sendMsgAndPosition( NM_NEW_POSITION, &gamePosition, playerOne.playerSocket );
+			sendMsgAndPosition( NM_NEW_POSITION, &gamePosition, playerTwo.playerSocket );
+		}
 
 		while( 1 )		//inside a game
 		{
@@ -170,8 +205,7 @@ int main( int argc, char **argv )
 			}
 
 			//send move to the other player
-			sendMsg( NM_PREPARE_TO_RECEIVE_MOVE, waitingPlayer->playerSocket );
-			sendMove( &tempMove, waitingPlayer->playerSocket );
+			sendMsgAndMove( NM_PREPARE_TO_RECEIVE_MOVE, &tempMove, waitingPlayer->playerSocket );
 
 
 		}
@@ -0,0 +1,158 @@
+#include "symmetry.h"
+#include <string.h>
+
+/**********************************************************/
+signed char symRow[ SYMMETRIES ][ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ];
+signed char symCol[ SYMMETRIES ][ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ];
+short symIndex[ SYMMETRIES ][ BB_BITS ];
+int symInverse[ SYMMETRIES ];
+
+/* hash keys of the image of each ( tile, color ), symmetries last so one disc is 12 adjacent keys */
+static uint64_t symZobrist[ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ][ 2 ][ SYMMETRIES ];
+
+static int symmetryInitialized = FALSE;
+
+/**********************************************************/
+void initSymmetry( void )
+{
+	int s, t, k, i, j, q, r, tmp;
+
+	if( symmetryInitialized )
+		return;
+
+	initBitBoards();
+	initZobrist();
+
+	for( s = 0; s < SYMMETRIES; s++ )
+	{
+		for( k = 0; k < BB_BITS; k++ )
+			symIndex[ s ][ k ] = -1;
+
+		for( i = 0; i < ARRAY_BOARD_SIZE; i++ )
+			for( j = 0; j < ARRAY_BOARD_SIZE; j++ )
+			{
+				q = j - HEX_BOARD_RADIUS;
+				r = i - HEX_BOARD_RADIUS;
+
+				if( s >= 6 )
+				{
+					tmp = q;
+					q = r;
+					r = tmp;
+				}
+				for( k = 0; k < s % 6; k++ )
+				{
+					tmp = q;
+					q = -r;
+					r = tmp + r;
+				}
+
+				symRow[ s ][ i ][ j ] = r + HEX_BOARD_RADIUS;
+				symCol[ s ][ i ][ j ] = q + HEX_BOARD_RADIUS;
+
+				if( bbTest( bbValid, BB_INDEX( i, j ) ) )
+				{
+					symIndex[ s ][ BB_INDEX( i, j ) ] = BB_INDEX( r + HEX_BOARD_RADIUS, q + HEX_BOARD_RADIUS );
+					symZobrist[ i ][ j ][ WHITE ][ s ] = zobristKeys[ r + HEX_BOARD_RADIUS ][ q + HEX_BOARD_RADIUS ][ WHITE ];
+					symZobrist[ i ][ j ][ BLACK ][ s ] = zobristKeys[ r + HEX_BOARD_RADIUS ][ q + HEX_BOARD_RADIUS ][ BLACK ];
+				}
+			}
+	}
+
+	/* inverses: the symmetry that brings a corner and its neighbour back */
+	i = 0;
+	j = HEX_BOARD_RADIUS;
+	for( s = 0; s < SYMMETRIES; s++ )
+		for( t = 0; t < SYMMETRIES; t++ )
+			if( symRow[ t ][ (int) symRow[ s ][ i ][ j ] ][ (int) symCol[ s ][ i ][ j ] ] == i
+				&& symCol[ t ][ (int) symRow[ s ][ i ][ j ] ][ (int) symCol[ s ][ i ][ j ] ] == j
+				&& symRow[ t ][ (int) symRow[ s ][ i ][ j + 1 ] ][ (int) symCol[ s ][ i ][ j + 1 ] ] == i
+				&& symCol[ t ][ (int) symRow[ s ][ i ][ j + 1 ] ][ (int) symCol[ s ][ i ][ j + 1 ] ] == j + 1 )
+				symInverse[ s ] = t;
+
+	symmetryInitialized = TRUE;
+}
+
+/**********************************************************/
+BitBoard symTransformBits( BitBoard b, int s )
+{
+	BitBoard image = bbZero();
+	int index;
+
+	for( index = bbFirst( b ); index >= 0; bbClear( &b, index ), index = bbFirst( b ) )
+		if( symIndex[ s ][ index ] >= 0 )
+			bbSet( &image, symIndex[ s ][ index ] );
+
+	return image;
+}
+
+/**********************************************************/
+void symTransformPosition( Position * from, Position * to, int s )
+{
+	int i, j;
+
+	initSymmetry();
+
+	for( i = 0; i < ARRAY_BOARD_SIZE; i++ )
+		for( j = 0; j < ARRAY_BOARD_SIZE; j++ )
+			to->board[ i ][ j ] = OUT_OF_BOUND;
+
+	for( i = 0; i < ARRAY_BOARD_SIZE; i++ )
+		for( j = 0; j < ARRAY_BOARD_SIZE; j++ )
+			if( bbTest( bbValid, BB_INDEX( i, j ) ) || from->board[ i ][ j ] == ILLEGAL )
+				to->board[ (int) symRow[ s ][ i ][ j ] ][ (int) symCol[ s ][ i ][ j ] ] = from->board[ i ][ j ];
+
+	to->turn = from->turn;
+	syncPosition( to );
+}
+
+/**********************************************************/
+void symTransformMove( Move * move, int s )
+{
+	int row = move->tile[ 0 ], col = move->tile[ 1 ];
+
+	if( row == NULL_MOVE )
+		return;
+
+	initSymmetry();
+	move->tile[ 0 ] = symRow[ s ][ row ][ col ];
+	move->tile[ 1 ] = symCol[ s ][ row ][ col ];
+}
+
+/**********************************************************/
+uint64_t canonicalHash( Position * pos, int * sym )
+{
+	/* the 12 hashes are built side by side, one pass over the discs */
+	uint64_t hash[ SYMMETRIES ], best;
+	BitBoard discs;
+	int s, c, index, row, col, bestSym = 0;
+
+	initSymmetry();
+
+	for( s = 0; s < SYMMETRIES; s++ )
+		hash[ s ] = ( pos->turn == BLACK ) ? zobristSide : 0;
+
+	for( c = WHITE; c <= BLACK; c++ )
+	{
+		discs = pos->pieces[ c ];
+		for( index = bbFirst( discs ); index >= 0; bbClear( &discs, index ), index = bbFirst( discs ) )
+		{
+			row = BB_ROW( index );
+			col = BB_COL( index );
+			for( s = 0; s < SYMMETRIES; s++ )
+				hash[ s ] ^= symZobrist[ row ][ col ][ c ][ s ];
+		}
+	}
+
+	best = hash[ 0 ];
+	for( s = 1; s < SYMMETRIES; s++ )
+		if( hash[ s ] < best )
+		{
+			best = hash[ s ];
+			bestSym = s;
+		}
+
+	if( sym != NULL )
+		*sym = bestSym;
+	return best;
+}
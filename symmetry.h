@@ -0,0 +1,45 @@
+#ifndef _SYMMETRY_H
+#define _SYMMETRY_H
+
+#include "global.h"
+#include "board.h"
+#include "move.h"
+
+/**********************************************************/
+
+/*
+Symmetries of the hexagon:
+
+Symmetry s (0 <= s < SYMMETRIES) is s % 6 rotations by 60 degrees after a
+reflection if s >= 6. Symmetry 0 is the identity. In axial coordinates around
+the centre ( q = col - R, r = row - R ) a rotation is ( q, r ) -> ( -r, q + r )
+and the reflection is ( q, r ) -> ( r, q ); both keep hex adjacency.
+
+Colors are not swapped, so the start position is only symmetric under part
+of the group, but every position and its 11 images share one canonical hash.
+*/
+#define SYMMETRIES 12
+
+/**********************************************************/
+extern signed char symRow[ SYMMETRIES ][ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ];	//image of tile ( row, col ) under each symmetry
+extern signed char symCol[ SYMMETRIES ][ ARRAY_BOARD_SIZE ][ ARRAY_BOARD_SIZE ];
+extern short symIndex[ SYMMETRIES ][ BB_BITS ];										//the same on bit indices, -1 off the board
+extern int symInverse[ SYMMETRIES ];												//symmetry that undoes each one
+/**********************************************************/
+
+void initSymmetry( void );
+//computes the tables (safe to call more than once)
+
+BitBoard symTransformBits( BitBoard b, int s );
+//image of a bitboard
+
+void symTransformPosition( Position * from, Position * to, int s );
+//image of a position (to may not be from)
+
+void symTransformMove( Move * move, int s );
+//image of a move (null moves stay null)
+
+uint64_t canonicalHash( Position * pos, int * sym );
+//smallest hash of the 12 images of pos (same for all of them), *sym is the symmetry that gives it (NULL if not needed)
+
+#endif
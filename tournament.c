@@ -0,0 +1,703 @@
+#include "global.h"
+#include "board.h"
+#include "move.h"
+#include "comm.h"
+#include "pack.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/epoll.h>
+
+/*
+ * Tournament server: many games at once between the clients that connect, on one
+ * thread. Sockets are non-blocking and served from one epoll loop, and every
+ * connection is a small state machine over the NM_* protocol of the server:
+ *
+ *	CONN_NAME		connected, the color, radius and name request are sent, waiting for the name
+ *	CONN_IDLE		waiting for a game
+ *	CONN_PLAYING	in a game, the opponent is to move
+ *	CONN_MOVE		in a game, NM_REQUEST_MOVE sent, waiting for the 2 bytes of the move
+ *
+ * Bytes are gathered per connection until a whole name or move is in, and what is
+ * sent is queued per connection and written when the socket takes it.
+ *
+ * Once -n clients have given their names the schedule is made: every pairing of
+ * a round robin, or of a gauntlet, plays -g games with the colors alternating. In
+ * a gauntlet the engine under test is every client with the name of the first
+ * one (a pool of instances, any idle one takes the next game) and each other
+ * client is an opponent. Games are started in schedule order as soon as their
+ * players are idle, so a client plays one game at a time and every client is
+ * busy while there are games for it. An illegal move or a lost connection loses
+ * the game; the games left to a lost client are dropped.
+ */
+
+#define MAX_EVENTS 256
+#define LISTEN_EVENT 0xFFFFFFFFu	//epoll data of the listening socket, the others hold their connection
+
+#define CONN_NAME 0
+#define CONN_IDLE 1
+#define CONN_PLAYING 2
+#define CONN_MOVE 3
+#define CONN_CLOSED 4
+
+#define GAME_QUEUED 0
+#define GAME_PLAYING 1
+#define GAME_DONE 2
+
+#define PAIRING_ROUND_ROBIN 0
+#define PAIRING_GAUNTLET 1
+
+#define ANY_INSTANCE -1				//scheduled player: any idle instance of the engine under test (gauntlet)
+
+/**********************************************************/
+typedef struct
+{
+	int socket;
+	int state;
+	char name[ MAX_NAME_LENGTH + 1 ];
+	int game;								// game being played, -1 if none
+	unsigned char in[ 2 + 256 ];			// received bytes not handled yet (a name at most)
+	int inLength;
+	unsigned char * out;					// bytes not sent yet
+	int outLength, outSize;
+	int wins, draws, losses;
+	long long discs;						// disc difference over its games
+	char instance;							// TRUE: an instance of the engine under test (gauntlet)
+} Connection;
+
+typedef struct
+{
+	int player[ 2 ];						// connections playing WHITE and BLACK (ANY_INSTANCE until the game starts)
+	int state;
+	Position pos;
+} Game;
+
+/**********************************************************/
+Connection * conns = NULL;
+int connCount = 0, connSize = 0;
+Game * schedule = NULL;
+int gameCount = 0, firstQueued = 0, gamesPlaying = 0, gamesDone = 0, mostPlaying = 0;
+int players = 2;
+int gamesPerPairing = 2;
+int pairing = PAIRING_ROUND_ROBIN;
+int packedPositions = FALSE;
+int verbose = FALSE;
+int instancesLeft = 0;						// connected instances of the engine under test
+int becameIdle = FALSE;						// TRUE: a connection became idle since the last startGames()
+int serverSocket, epollFd;
+struct timespec started;					// when the schedule was made
+
+/**********************************************************/
+void setNonBlocking( int fd )
+{
+	fcntl( fd, F_SETFL, fcntl( fd, F_GETFL, 0 ) | O_NONBLOCK );
+}
+
+/**********************************************************/
+void watch( int c )
+{
+	/* reads always, writes too while there are bytes waiting */
+	struct epoll_event ev;
+
+	ev.events = EPOLLIN | ( conns[ c ].outLength > 0 ? EPOLLOUT : 0 );
+	ev.data.u32 = c;
+	epoll_ctl( epollFd, EPOLL_CTL_MOD, conns[ c ].socket, &ev );
+}
+
+/**********************************************************/
+void dropConnection( int c );
+
+void flush( int c )
+{
+	Connection * conn = &conns[ c ];
+	int waiting = conn->outLength > 0;
+	ssize_t n;
+
+	while( conn->outLength > 0 )
+	{
+		n = send( conn->socket, conn->out, conn->outLength, MSG_NOSIGNAL );
+		if( n < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+			if( errno == EAGAIN || errno == EWOULDBLOCK )
+				break;
+			dropConnection( c );
+			return;
+		}
+		memmove( conn->out, conn->out + n, conn->outLength - n );
+		conn->outLength -= n;
+	}
+
+	if( waiting != ( conn->outLength > 0 ) )
+		watch( c );
+}
+
+/**********************************************************/
+void queueBytes( int c, void * data, int length )
+{
+	Connection * conn = &conns[ c ];
+
+	if( conn->state == CONN_CLOSED )
+		return;
+
+	if( conn->outLength + length > conn->outSize )
+	{
+		conn->outSize = 2 * ( conn->outLength + length );
+		if( ( conn->out = realloc( conn->out, conn->outSize ) ) == NULL )
+		{
+			printf( "ERROR: Out of memory\n" );
+			exit( 1 );
+		}
+	}
+
+	memcpy( conn->out + conn->outLength, data, length );
+	conn->outLength += length;
+}
+
+/**********************************************************/
+void queueMsg( int c, int msg )
+{
+	char msgCode = ( char ) msg;
+	queueBytes( c, &msgCode, 1 );
+}
+
+/**********************************************************/
+void queuePosition( int c, Position * pos )
+{
+	/* the bytes of sendPosition() or sendPackedPosition() */
+	char buffer[ ARRAY_BOARD_SIZE * ARRAY_BOARD_SIZE + 2 + 1 ];
+	unsigned char packed[ PACKED_POSITION_BYTES ];
+	int i, j;
+
+	if( packedPositions )
+	{
+		packPosition( pos, packed );
+		queueMsg( c, NM_NEW_POSITION_PACKED );
+		queueBytes( c, packed, PACKED_POSITION_BYTES );
+		return;
+	}
+
+	for( i = 0; i < ARRAY_BOARD_SIZE; i++ )
+		for( j = 0; j < ARRAY_BOARD_SIZE; j++ )
+			buffer[ i * ARRAY_BOARD_SIZE + j ] = pos->board[ i ][ j ];
+	buffer[ ARRAY_BOARD_SIZE * ARRAY_BOARD_SIZE ] = pos->score[ WHITE ];
+	buffer[ ARRAY_BOARD_SIZE * ARRAY_BOARD_SIZE + 1 ] = pos->score[ BLACK ];
+	buffer[ ARRAY_BOARD_SIZE * ARRAY_BOARD_SIZE + 2 ] = pos->turn;
+
+	queueMsg( c, NM_NEW_POSITION );
+	queueBytes( c, buffer, sizeof( buffer ) );
+}
+
+/**********************************************************/
+void requestMove( Game * game )
+{
+	int c = game->player[ ( int ) game->pos.turn ];
+
+	conns[ c ].state = CONN_MOVE;
+	queueMsg( c, NM_REQUEST_MOVE );
+}
+
+/**********************************************************/
+void endGame( Game * game, int loser )
+{
+	/* loser: the color that lost by an illegal move or a lost connection, -1 if the game was played out */
+	int diff = game->pos.score[ WHITE ] - game->pos.score[ BLACK ];
+	int color, c;
+
+	if( loser == WHITE && diff >= 0 )
+		diff = -1;
+	if( loser == BLACK && diff <= 0 )
+		diff = 1;
+
+	for( color = WHITE; color <= BLACK; color++ )
+	{
+		c = game->player[ color ];
+		if( diff == 0 )
+			conns[ c ].draws++;
+		else if( ( diff > 0 ) == ( color == WHITE ) )
+			conns[ c ].wins++;
+		else
+			conns[ c ].losses++;
+		conns[ c ].discs += color == WHITE ? diff : -diff;
+		conns[ c ].game = -1;
+		if( conns[ c ].state != CONN_CLOSED )
+			conns[ c ].state = CONN_IDLE;
+		becameIdle = TRUE;
+	}
+
+	if( verbose || loser >= 0 )
+		printf( "Game %d: #%d %s (W) vs #%d %s (B) W:%d B:%d%s\n", ( int ) ( game - schedule ) + 1,
+			game->player[ WHITE ], conns[ game->player[ WHITE ] ].name, game->player[ BLACK ], conns[ game->player[ BLACK ] ].name,
+			game->pos.score[ WHITE ], game->pos.score[ BLACK ], loser < 0 ? "" : ( loser == WHITE ? " WHITE lost by forfeit" : " BLACK lost by forfeit" ) );
+
+	game->state = GAME_DONE;
+	gamesPlaying--;
+	gamesDone++;
+}
+
+/**********************************************************/
+int idlePlayer( int scheduled, int other )
+{
+	/* the connection that can play a scheduled player now, -1 if none */
+	int c;
+
+	if( scheduled != ANY_INSTANCE )
+		return conns[ scheduled ].state == CONN_IDLE ? scheduled : -1;
+
+	for( c = 0; c < connCount; c++ )
+		if( conns[ c ].instance && conns[ c ].state == CONN_IDLE && c != other )
+			return c;
+	return -1;
+}
+
+/**********************************************************/
+int lostPlayer( int scheduled )
+{
+	/* TRUE if no connection will ever play a scheduled player */
+	return scheduled == ANY_INSTANCE ? instancesLeft == 0 : conns[ scheduled ].state == CONN_CLOSED;
+}
+
+/**********************************************************/
+void startGames( void )
+{
+	/* drops the queued games of lost clients and starts every one whose players are idle, in schedule order */
+	Game * game;
+	int g, color, c, w, b, idle = 0;
+
+	for( c = 0; c < connCount; c++ )
+		idle += conns[ c ].state == CONN_IDLE;
+
+	for( g = firstQueued; g < gameCount; g++ )
+	{
+		game = &schedule[ g ];
+		if( game->state != GAME_QUEUED )
+			continue;
+		if( lostPlayer( game->player[ WHITE ] ) || lostPlayer( game->player[ BLACK ] ) )
+		{
+			game->state = GAME_DONE;		//dropped
+			continue;
+		}
+		if( idle < 2 )
+			continue;
+		w = idlePlayer( game->player[ WHITE ], -1 );
+		b = idlePlayer( game->player[ BLACK ], w );
+		if( w < 0 || b < 0 )
+			continue;
+
+		game->state = GAME_PLAYING;
+		game->player[ WHITE ] = w;
+		game->player[ BLACK ] = b;
+		if( ++gamesPlaying > mostPlaying )
+			mostPlaying = gamesPlaying;
+		idle -= 2;
+		initPosition( &game->pos );
+		for( color = WHITE; color <= BLACK; color++ )
+		{
+			c = game->player[ color ];
+			conns[ c ].state = CONN_PLAYING;
+			conns[ c ].game = g;
+			queueMsg( c, color == WHITE ? NM_COLOR_W : NM_COLOR_B );
+			queuePosition( c, &game->pos );
+		}
+		requestMove( game );
+		flush( w );
+		flush( b );
+	}
+
+	/* nothing running and nothing could start: the games left can never be played */
+	if( gamesPlaying == 0 )
+		for( g = firstQueued; g < gameCount; g++ )
+			if( schedule[ g ].state == GAME_QUEUED )
+				schedule[ g ].state = GAME_DONE;		//dropped
+
+	while( firstQueued < gameCount && schedule[ firstQueued ].state != GAME_QUEUED )
+		firstQueued++;
+	becameIdle = FALSE;
+}
+
+/**********************************************************/
+void playMove( int c, Move * move )
+{
+	/* the move of connection c, checked as the server does */
+	Game * game = &schedule[ conns[ c ].game ];
+	int color = game->pos.turn, other;
+
+	move->color = color;
+	if( !canMove( &game->pos, color ) ? move->tile[ 0 ] != NULL_MOVE : !isLegalMove( &game->pos, move ) )
+	{
+		printf( "Player: #%d %s tried an illegal move and lost the game!\n", c, conns[ c ].name );
+		endGame( game, color );
+		return;
+	}
+
+	doMove( &game->pos, move );
+	conns[ c ].state = CONN_PLAYING;
+
+	if( !canMove( &game->pos, WHITE ) && !canMove( &game->pos, BLACK ) )
+	{
+		endGame( game, -1 );
+		return;
+	}
+
+	other = game->player[ getOtherSide( color ) ];
+	queueMsg( other, NM_PREPARE_TO_RECEIVE_MOVE );
+	queueBytes( other, move->tile, 2 );
+	requestMove( game );		//the other side, or the same one after a null move
+	flush( other );
+	flush( c );
+}
+
+/**********************************************************/
+void registered( int c )
+{
+	/* c gave its name: make the schedule once everyone is in */
+	int id[ connCount ], opponent[ connCount ], a, b, k, n = 0, opponents = 0;
+
+	conns[ c ].state = CONN_IDLE;
+	becameIdle = TRUE;
+	printf( "#%d %s connected\n", c, conns[ c ].name );
+
+	for( a = 0; a < connCount; a++ )
+		if( conns[ a ].state == CONN_IDLE )
+			id[ n++ ] = a;
+	if( schedule != NULL || n < players )
+		return;
+
+	if( pairing == PAIRING_GAUNTLET )
+	{
+		for( a = 0; a < n; a++ )
+			if( strcmp( conns[ id[ a ] ].name, conns[ id[ 0 ] ].name ) == 0 )
+			{
+				conns[ id[ a ] ].instance = TRUE;
+				instancesLeft++;
+			}
+			else
+				opponent[ opponents++ ] = id[ a ];
+		if( opponents == 0 )
+		{
+			printf( "ERROR: Every player is named %s, a gauntlet needs opponents with other names\n", conns[ id[ 0 ] ].name );
+			exit( 1 );
+		}
+		gameCount = opponents * gamesPerPairing;
+	}
+	else
+		gameCount = n * ( n - 1 ) / 2 * gamesPerPairing;
+
+	if( ( schedule = malloc( sizeof( Game ) * gameCount ) ) == NULL )
+	{
+		printf( "ERROR: Out of memory\n" );
+		exit( 1 );
+	}
+
+	/* one game of every pairing per round, so the first games already keep everyone busy */
+	gameCount = 0;
+	for( k = 0; k < gamesPerPairing; k++ )
+		for( a = 0; a < ( pairing == PAIRING_GAUNTLET ? opponents : n ); a++ )
+			for( b = a + 1; b < ( pairing == PAIRING_GAUNTLET ? a + 2 : n ); b++ )
+			{
+				schedule[ gameCount ].player[ k % 2 == 0 ? WHITE : BLACK ] = pairing == PAIRING_GAUNTLET ? ANY_INSTANCE : id[ a ];
+				schedule[ gameCount ].player[ k % 2 == 0 ? BLACK : WHITE ] = pairing == PAIRING_GAUNTLET ? opponent[ a ] : id[ b ];
+				schedule[ gameCount ].state = GAME_QUEUED;
+				gameCount++;
+			}
+
+	if( pairing == PAIRING_GAUNTLET )
+		printf( "%d games of %d instances of %s against %d players (gauntlet)\n", gameCount, instancesLeft, conns[ id[ 0 ] ].name, opponents );
+	else
+		printf( "%d games between %d players (round robin)\n", gameCount, n );
+	clock_gettime( CLOCK_MONOTONIC, &started );
+}
+
+/**********************************************************/
+void dropConnection( int c )
+{
+	Connection * conn = &conns[ c ];
+	Game * game;
+
+	if( conn->state == CONN_CLOSED )
+		return;
+
+	if( conn->game >= 0 )
+	{
+		game = &schedule[ conn->game ];
+		printf( "Player: #%d %s lost the connection and the game!\n", c, conn->name );
+		conn->state = CONN_CLOSED;
+		endGame( game, game->player[ WHITE ] == c ? WHITE : BLACK );
+	}
+	else if( conn->state != CONN_NAME )
+		printf( "Player: #%d %s lost the connection\n", c, conn->name );
+
+	conn->state = CONN_CLOSED;
+	conn->outLength = 0;
+	if( conn->instance )
+		instancesLeft--;
+	becameIdle = TRUE;		//its games may have to be dropped
+	epoll_ctl( epollFd, EPOLL_CTL_DEL, conn->socket, NULL );
+	close( conn->socket );
+}
+
+/**********************************************************/
+void readConnection( int c )
+{
+	Connection * conn = &conns[ c ];
+	Move move;
+	ssize_t n;
+	int size, used;
+
+	while( conn->state != CONN_CLOSED )
+	{
+		n = recv( conn->socket, conn->in + conn->inLength, sizeof( conn->in ) - conn->inLength, 0 );
+		if( n == 0 || ( n < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK ) )
+		{
+			dropConnection( c );
+			return;
+		}
+		if( n < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+			return;
+		}
+		conn->inLength += n;
+
+		/* whole messages of the current state */
+		while( conn->inLength > 0 && conn->state != CONN_CLOSED )
+		{
+			used = 0;
+			if( conn->state == CONN_NAME )
+			{
+				size = ( unsigned char ) conn->in[ 0 ];
+				if( conn->inLength < 1 + size )
+					break;
+				if( size > MAX_NAME_LENGTH ) size = MAX_NAME_LENGTH;
+				memcpy( conn->name, conn->in + 1, size );
+				conn->name[ size ] = '\0';
+				used = 1 + ( unsigned char ) conn->in[ 0 ];
+				registered( c );
+			}
+			else if( conn->state == CONN_MOVE )
+			{
+				if( conn->inLength < 2 )
+					break;
+				move.tile[ 0 ] = ( char ) conn->in[ 0 ];
+				move.tile[ 1 ] = ( char ) conn->in[ 1 ];
+				used = 2;
+				playMove( c, &move );
+			}
+			else
+				used = conn->inLength;		//nothing is expected now
+
+			memmove( conn->in, conn->in + used, conn->inLength - used );
+			conn->inLength -= used;
+		}
+	}
+}
+
+/**********************************************************/
+void acceptConnections( void )
+{
+	struct epoll_event ev;
+	Connection * conn;
+	int fd, c;
+
+	while( ( fd = accept( serverSocket, NULL, NULL ) ) >= 0 )
+	{
+		if( schedule != NULL )
+		{
+			close( fd );		//the tournament has started
+			continue;
+		}
+
+		if( connCount == connSize )
+		{
+			connSize = connSize ? 2 * connSize : 64;
+			if( ( conns = realloc( conns, sizeof( Connection ) * connSize ) ) == NULL )
+			{
+				printf( "ERROR: Out of memory\n" );
+				exit( 1 );
+			}
+		}
+
+		c = connCount++;
+		conn = &conns[ c ];
+		memset( conn, 0, sizeof( Connection ) );
+		conn->socket = fd;
+		conn->state = CONN_NAME;
+		conn->game = -1;
+		setNonBlocking( fd );
+		setNoDelay( fd );
+
+		ev.events = EPOLLIN;
+		ev.data.u32 = c;
+		epoll_ctl( epollFd, EPOLL_CTL_ADD, fd, &ev );
+
+		/* colors are sent again before every game */
+		queueMsg( c, NM_COLOR_W );
+		queueMsg( c, NM_BOARD_RADIUS );
+		queueMsg( c, HEX_BOARD_RADIUS );
+		queueMsg( c, NM_REQUEST_NAME );
+		flush( c );
+	}
+}
+
+/**********************************************************/
+int comparePlayers( const void * a, const void * b )
+{
+	const Connection * x = &conns[ *( int * ) a ], * y = &conns[ *( int * ) b ];
+	int px = 2 * x->wins + x->draws, py = 2 * y->wins + y->draws;
+
+	if( px != py )
+		return py - px;
+	return ( y->discs > x->discs ) - ( y->discs < x->discs );
+}
+
+/**********************************************************/
+void standings( double elapsed )
+{
+	int order[ connCount ], k, c, n, rank = 0;
+
+	for( k = 0; k < connCount; k++ )
+		order[ k ] = k;
+	qsort( order, connCount, sizeof( int ), comparePlayers );
+
+	printf( "%d games in %.1f s (%.1f games/s, %d at once at most)", gamesDone, elapsed, gamesDone / elapsed, mostPlaying );
+	if( gamesDone < gameCount )
+		printf( ", %d dropped", gameCount - gamesDone );
+	printf( "\n" );
+	printf( "      player     points   W / D / L   discs/game\n" );
+	for( k = 0; k < connCount; k++ )
+	{
+		c = order[ k ];
+		n = conns[ c ].wins + conns[ c ].draws + conns[ c ].losses;
+		if( conns[ c ].state == CONN_NAME )
+			continue;
+		printf( "%3d #%-4d %-8s %6.1f   %d / %d / %d   %+.1f%s\n", ++rank, c, conns[ c ].name, conns[ c ].wins + 0.5 * conns[ c ].draws,
+			conns[ c ].wins, conns[ c ].draws, conns[ c ].losses, n ? ( double ) conns[ c ].discs / n : 0.0,
+			conns[ c ].state == CONN_CLOSED ? " (left)" : "" );
+	}
+}
+
+/**********************************************************/
+int main( int argc, char ** argv )
+{
+	struct epoll_event ev, events[ MAX_EVENTS ];
+	struct timespec finished;
+	int c, k, n;
+
+	opterr = 0;
+	while( ( c = getopt( argc, argv, "p:n:g:m:cvh" ) ) != -1 )
+		switch( c )
+		{
+			case 'h':
+				printf( "[-p port] [-n players] [-g games_per_pairing] [-m roundrobin|gauntlet] [-c (send packed positions)] [-v (print every game)]\n" );
+				return 0;
+			case 'p':
+				port = optarg;
+				break;
+			case 'n':
+				players = atoi( optarg );
+				break;
+			case 'g':
+				gamesPerPairing = atoi( optarg );
+				break;
+			case 'm':
+				if( strcmp( optarg, "roundrobin" ) == 0 )
+					pairing = PAIRING_ROUND_ROBIN;
+				else if( strcmp( optarg, "gauntlet" ) == 0 )
+					pairing = PAIRING_GAUNTLET;
+				else
+				{
+					printf( "Unknown pairing %s\n", optarg );
+					return 1;
+				}
+				break;
+			case 'c':
+				packedPositions = TRUE;
+				break;
+			case 'v':
+				verbose = TRUE;
+				break;
+			case '?':
+				if( isprint( optopt ) )
+					printf( "Unknown option or missing argument -%c\n", ( char ) optopt );
+				else
+					printf( "Unknown option character -%c\n", ( char ) optopt );
+				return 1;
+			default:
+				return 1;
+		}
+
+	if( players < 2 || gamesPerPairing < 1 )
+	{
+		printf( "A tournament needs 2 players and a game per pairing at least\n" );
+		return 1;
+	}
+
+	signal( SIGPIPE, SIG_IGN );
+
+	listenToSocket( port, &serverSocket );
+	listen( serverSocket, SOMAXCONN );		//a deeper queue for many clients connecting at once
+	setNonBlocking( serverSocket );
+
+	if( ( epollFd = epoll_create1( 0 ) ) < 0 )
+	{
+		printf( "ERROR: epoll_create1 failed\n" );
+		return 1;
+	}
+	ev.events = EPOLLIN;
+	ev.data.u32 = LISTEN_EVENT;
+	epoll_ctl( epollFd, EPOLL_CTL_ADD, serverSocket, &ev );
+
+	printf( "Waiting for %d players...\n", players );
+
+	while( schedule == NULL || gamesPlaying > 0 || firstQueued < gameCount )
+	{
+		if( ( n = epoll_wait( epollFd, events, MAX_EVENTS, -1 ) ) < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+			printf( "ERROR: epoll_wait failed\n" );
+			return 1;
+		}
+
+		for( k = 0; k < n; k++ )
+		{
+			if( events[ k ].data.u32 == LISTEN_EVENT )
+			{
+				acceptConnections();
+				continue;
+			}
+
+			c = events[ k ].data.u32;
+			if( conns[ c ].state == CONN_CLOSED )
+				continue;
+			if( events[ k ].events & EPOLLOUT )
+				flush( c );
+			if( events[ k ].events & ( EPOLLIN | EPOLLHUP | EPOLLERR ) )
+				readConnection( c );
+		}
+
+		if( schedule != NULL && becameIdle )
+			startGames();
+	}
+
+	clock_gettime( CLOCK_MONOTONIC, &finished );
+
+	/* the last bytes and NM_QUIT, blocking */
+	for( c = 0; c < connCount; c++ )
+		if( conns[ c ].state != CONN_CLOSED )
+		{
+			queueMsg( c, NM_QUIT );
+			fcntl( conns[ c ].socket, F_SETFL, fcntl( conns[ c ].socket, F_GETFL, 0 ) & ~O_NONBLOCK );
+			flush( c );
+		}
+
+	standings( ( finished.tv_sec - started.tv_sec ) + ( finished.tv_nsec - started.tv_nsec ) / 1e9 );
+	return 0;
+}
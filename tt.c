@@ -0,0 +1,225 @@
+#include "tt.h"
+#include "alloc.h"
+#include "eval.h"
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// data: score (low 32 bits), move (16), depth (8), bound (2), generation (6).
+typedef struct {
+    uint64_t check;			// key ^ data
+    uint64_t data;
+} TTEntry;
+
+typedef struct {
+    TTEntry e[TT_BUCKET];
+} TTBucket;
+
+typedef struct {
+    int magic, version, radius, bucketBytes;
+    uint64_t buckets;
+    uint64_t evaluation;		// evalFingerprint() of the engine that fills the table
+    uint32_t generation;
+    char unused[64 - 5 * sizeof(int) - 2 * sizeof(uint64_t)];
+} TTHeader;
+
+#define TT_GENERATIONS 64
+#define TT_AGE_WEIGHT 4		// one generation older counts as this many plies shallower
+
+static void *ttMap = NULL;		// the file mapping, NULL for a table in memory
+static size_t ttMapBytes;			// bytes of the file mapping, or of the memory allocTable() mapped
+static TTHeader *ttHeader;
+static TTHeader ttMemoryHeader;
+static int ttFile = -1;
+void *ttTable = NULL;
+uint64_t ttMask;
+int ttPages = PAGES_NORMAL;
+__thread TTStats ttStats;
+__thread uint64_t ttSalt = 0;
+static __thread uint32_t ttGeneration = 0;	// generation of this thread's search, set by ttNewSearch()
+
+
+static uint64_t packData(int score, int move, int depth, int bound, int generation){
+    return (uint32_t) score | (uint64_t) (move & 0xFFFF) << 32 | (uint64_t) (depth & 0xFF) << 48
+           | (uint64_t) bound << 56 | (uint64_t) generation << 58;
+}
+
+
+static int mapFile(char *fileName, size_t bytes){
+    // Maps fileName, creating it with bytes of buckets if it is new. Returns the bucket bytes, -1 on failure.
+    struct stat st;
+    TTHeader header = { TT_FILE_MAGIC, TT_FILE_VERSION, HEX_BOARD_RADIUS, sizeof(TTBucket), bytes / sizeof(TTBucket),
+                        evalFingerprint(), 0, { 0 } };
+    int shared = TRUE;
+
+    if ((ttFile = open(fileName, O_RDWR | O_CREAT, 0644)) < 0) {
+        printf("ERROR: Cannot open transposition table %s\n", fileName);
+        return -1;
+    }
+
+    if (flock(ttFile, LOCK_EX | LOCK_NB) < 0) {
+        printf("Transposition table %s is in use, its entries are read but not saved\n", fileName);
+        shared = FALSE;
+    }
+
+    if (fstat(ttFile, &st) < 0)
+        goto fail;
+
+    if (st.st_size == 0 && shared) {
+        if (ftruncate(ttFile, sizeof(TTHeader) + bytes) < 0 || pwrite(ttFile, &header, sizeof(header), 0) != sizeof(header))
+            goto fail;
+        st.st_size = sizeof(TTHeader) + bytes;
+    }
+
+    if (st.st_size < (off_t) sizeof(TTHeader) || pread(ttFile, &header, sizeof(header), 0) != sizeof(header)
+        || header.magic != TT_FILE_MAGIC || header.version != TT_FILE_VERSION || header.radius != HEX_BOARD_RADIUS
+        || header.bucketBytes != sizeof(TTBucket) || header.buckets == 0 || (header.buckets & (header.buckets - 1))
+        || (uint64_t) st.st_size != sizeof(TTHeader) + header.buckets * sizeof(TTBucket)) {
+        printf("ERROR: %s is not a transposition table for this board\n", fileName);
+        close(ttFile);
+        ttFile = -1;
+        return -1;
+    }
+
+    if (header.evaluation != evalFingerprint()) {
+        printf("ERROR: %s was filled by another evaluation (-e, -w)\n", fileName);
+        close(ttFile);
+        ttFile = -1;
+        return -1;
+    }
+
+    ttMap = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, shared ? MAP_SHARED : MAP_PRIVATE, ttFile, 0);
+    if (ttMap == MAP_FAILED)
+        goto fail;
+    ttMapBytes = st.st_size;
+    return header.buckets * sizeof(TTBucket);
+
+fail:
+    printf("ERROR: Cannot map transposition table %s\n", fileName);
+    close(ttFile);
+    ttFile = -1;
+    ttMap = NULL;
+    return -1;
+}
+
+
+int initTT(int megabytes, char *fileName){
+    size_t bytes = sizeof(TTBucket);
+    int mapped;
+
+    closeTT();
+    memset(&ttStats, 0, sizeof(ttStats));
+    if (megabytes <= 0)
+        return 0;
+
+    while (2 * bytes <= (size_t) megabytes << 20)
+        bytes *= 2;
+
+    if (fileName != NULL) {
+        if ((mapped = mapFile(fileName, bytes)) < 0)
+            return -1;
+        ttHeader = ttMap;
+        ttTable = ttHeader + 1;
+        ttPages = PAGES_NORMAL;
+        bytes = mapped;
+    } else {
+        if ((ttTable = allocTable(bytes, &ttPages, &ttMapBytes)) == NULL) {
+            printf("ERROR: Cannot allocate a %d MB transposition table\n", megabytes);
+            return -1;
+        }
+        ttHeader = &ttMemoryHeader;
+    }
+
+    ttMask = bytes / sizeof(TTBucket) - 1;
+    return 0;
+}
+
+
+void closeTT(void){
+    if (ttMap != NULL)
+        munmap(ttMap, ttMapBytes);		// the kernel writes a shared mapping back to the file
+    else if (ttTable != NULL)
+        freeTable(ttTable, ttMapBytes);
+    if (ttFile >= 0)
+        close(ttFile);				// and releases the lock
+    ttMap = NULL;
+    ttTable = NULL;
+    ttFile = -1;
+}
+
+
+size_t ttBytes(void){
+    return ttTable ? (ttMask + 1) * sizeof(TTBucket) : 0;
+}
+
+
+void ttNewSearch(void){
+    if (ttTable)
+        ttGeneration = __atomic_add_fetch(&ttHeader->generation, 1, __ATOMIC_RELAXED) % TT_GENERATIONS;
+}
+
+
+int ttProbe(uint64_t key, TTData *data){
+    TTEntry *e;
+    uint64_t d;
+    int k;
+
+    if (!ttTable)
+        return FALSE;
+
+    key ^= ttSalt;
+    ttStats.probes++;
+    e = ((TTBucket *) ttTable)[key & ttMask].e;
+    for (k = 0; k < TT_BUCKET; k++) {
+        d = __atomic_load_n(&e[k].data, __ATOMIC_RELAXED);
+        if ((__atomic_load_n(&e[k].check, __ATOMIC_RELAXED) ^ d) != key || d == 0)
+            continue;
+        data->score = (int32_t) (uint32_t) d;
+        data->move = (d >> 32) & 0xFFFF;
+        data->depth = (d >> 48) & 0xFF;
+        data->bound = (d >> 56) & 3;
+        ttStats.hits++;
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+
+void ttStore(uint64_t key, int score, int move, int depth, int bound){
+    // Same position first (unless it holds a deeper result of this search), else the
+    // entry with the lowest depth - TT_AGE_WEIGHT * age.
+    TTEntry *e, *victim = NULL;
+    uint64_t d, data;
+    int k, age, worth, worst = 1 << 30, generation;
+
+    if (!ttTable)
+        return;
+
+    key ^= ttSalt;
+    generation = ttGeneration;
+    e = ((TTBucket *) ttTable)[key & ttMask].e;
+    for (k = 0; k < TT_BUCKET; k++) {
+        d = __atomic_load_n(&e[k].data, __ATOMIC_RELAXED);
+        age = (generation - (int) (d >> 58) + TT_GENERATIONS) % TT_GENERATIONS;
+        if ((__atomic_load_n(&e[k].check, __ATOMIC_RELAXED) ^ d) == key && d != 0) {
+            if (age == 0 && (int) ((d >> 48) & 0xFF) > depth && bound != TT_EXACT)
+                return;
+            victim = &e[k];
+            break;
+        }
+        worth = d == 0 ? -(1 << 20) : (int) ((d >> 48) & 0xFF) - TT_AGE_WEIGHT * age;
+        if (worth < worst) {
+            worst = worth;
+            victim = &e[k];
+        }
+    }
+
+    data = packData(score, move, depth, bound, generation);
+    __atomic_store_n(&victim->check, key ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&victim->data, data, __ATOMIC_RELAXED);
+}
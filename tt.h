@@ -0,0 +1,84 @@
+#ifndef TT_H
+#define TT_H
+
+#include "global.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Transposition table: search results keyed by the position hash, in buckets of
+ * TT_BUCKET entries (one cache line). Scores are from WHITE's point of view, as
+ * in minimax(). Entries are lock-free like the evaluation cache (key ^ data next
+ * to data), so threads may share the table.
+ *
+ * The table is anonymous memory, or a file mapped with MAP_SHARED that keeps it
+ * across games and restarts:
+ *	TTHeader (64 bytes, format version, board radius, size, evaluation, generation), then the buckets.
+ * The evaluation is a hash of the evaluator and its weights (evalFingerprint()): a file
+ * filled by another evaluation is refused, so load the weights before initTT().
+ * Only one process writes to a file: the first one takes an exclusive flock(),
+ * any other one gets a private copy of the file (it reads the saved entries,
+ * its own writes are not saved).
+ *
+ * Every search starts a new generation; entries of older generations are
+ * replaced first, deep ones later than shallow ones. A thread keeps the
+ * generation of its own search, so searches started by other threads
+ * meanwhile do not age its entries.
+ */
+#define TT_MB 64				// default size
+#define TT_BUCKET 4
+#define TT_FILE_MAGIC 0x54545848	// "HXTT"
+#define TT_FILE_VERSION 2
+
+#define TT_LOWER 1				// the search failed high: score is a lower bound
+#define TT_UPPER 2				// it failed low: score is an upper bound
+#define TT_EXACT 3
+#define TT_NO_MOVE 0xFFFF
+
+#define TT_BUCKET_BYTES (TT_BUCKET * 16)
+
+typedef struct {
+    int score;
+    int move;					// row * ARRAY_BOARD_SIZE + col, TT_NO_MOVE if none
+    int depth;					// plies searched below the position
+    int bound;
+} TTData;
+
+typedef struct {
+    long long probes;
+    long long hits;
+    long long cutoffs;			// probes that ended the search of a node
+} TTStats;
+
+extern __thread TTStats ttStats;	// per thread
+extern __thread uint64_t ttSalt;	// xored into the keys, engines with other settings do not share entries (engine.h)
+extern void *ttTable;				// the buckets, NULL if there is no table
+extern uint64_t ttMask;				// buckets - 1
+extern int ttPages;					// how the buckets are backed (alloc.h)
+
+int initTT(int megabytes, char *fileName);
+// (re)creates the table with the largest power of two buckets that fits (0 turns it off), in memory or
+// mapped from fileName (NULL: memory only; an existing file keeps its own size), returns 0 on success and -1 on failure
+
+void closeTT(void);
+// unmaps the table (a file keeps its entries)
+
+size_t ttBytes(void);
+// memory used by the buckets
+
+void ttNewSearch(void);
+// starts a generation for the searches of this thread
+
+int ttProbe(uint64_t key, TTData *data);
+// TRUE and the entry of key if there is one
+
+void ttStore(uint64_t key, int score, int move, int depth, int bound);
+// saves a search result
+
+static inline void ttPrefetch(uint64_t key){
+    // Starts loading the bucket of key (called when a move is made, the probe comes after move generation).
+    if (ttTable)
+        __builtin_prefetch((char *) ttTable + ((key ^ ttSalt) & ttMask) * TT_BUCKET_BYTES);
+}
+
+#endif
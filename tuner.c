@@ -0,0 +1,479 @@
+#include "global.h"
+#include "board.h"
+#include "eval.h"
+#include "pack.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+/*
+ * Offline tuner for the classic evaluation weights (Texel method).
+ *
+ * Input: one position per line
+ *		<HEX_CELLS tiles: 'w' 'b' or '.', row by row> <side to move: w|b> <result for WHITE: 1, 0.5 or 0>
+ * or, with -p, binary records of PACKED_RECORD_BYTES (see pack.h).
+ *
+ * The weights of every phase are fitted by minimizing the logistic loss between
+ * the game results and sigmoid(K * evaluate()), with K fitted first for the
+ * starting weights. Features are extracted once, then every iteration computes the
+ * loss gradient over all positions on several threads.
+ */
+
+#define MAX_THREADS 64
+#define LOAD_BLOCK 65536		// lines parsed per block while loading
+#define PARAMS ( EVAL_PHASES * EVAL_FEATURES + 1 )	// the features of every phase and the endgame weight
+#define ENDGAME_PARAM ( EVAL_PHASES * EVAL_FEATURES )
+
+/**********************************************************/
+typedef struct
+{
+	short f[ EVAL_FEATURES ];	// features, f[ F_PIECES ] is also used in the endgame
+	char phase;					// between phase and phase + 1 (EVAL_PHASES: only the endgame weight applies)
+	float t;					// how far towards phase + 1 (0..1)
+	float result;				// 1 WHITE won, 0.5 draw, 0 BLACK won
+} Sample;
+
+typedef struct
+{
+	int first, last;			// samples [first, last) of this thread
+	double * params;			// current weights
+	double k;					// sigmoid scale
+	double loss;				// output
+	double grad[ PARAMS ];		// output
+} Job;
+
+typedef struct
+{
+	char ** lines;				// text input
+	unsigned char * records;	// packed input (used if not NULL)
+	Sample * out;
+	char * ok;
+	int first, last;
+} LoadJob;
+
+/**********************************************************/
+Sample * samples = NULL;
+int sampleCount = 0;
+int threads = 4;
+int packedInput = FALSE;
+
+/**********************************************************/
+void sampleFromPosition( Position * pos, double result, Sample * s )
+{
+	int f[ EVAL_FEATURES ], k, phase, t;
+
+	evalFeatures( pos, f );
+
+	for( k = 0; k < EVAL_FEATURES; k++ )
+		s->f[ k ] = f[ k ];
+	evalPhase( HEX_CELLS - pos->score[ WHITE ] - pos->score[ BLACK ], &phase, &t );
+	if( pos->score[ WHITE ] + pos->score[ BLACK ] > ENDGAME_DISCS )
+	{
+		phase = EVAL_PHASES;	//same test as evaluate()
+		t = 0;
+	}
+	s->phase = phase;
+	s->t = ( float ) t / EVAL_TAPER_SCALE;
+	s->result = result;
+}
+
+/**********************************************************/
+int parseSample( char * line, Sample * s )
+{
+	Position pos;
+	int i, j, n = 0;
+	char * p = line;
+	double result;
+
+	initPosition( &pos );
+
+	for( i = 0; i < ARRAY_BOARD_SIZE; i++ )
+		for( j = 0; j < ARRAY_BOARD_SIZE; j++ )
+		{
+			if( pos.board[ i ][ j ] == OUT_OF_BOUND )
+				continue;
+			switch( *p++ )
+			{
+				case 'w': pos.board[ i ][ j ] = WHITE; break;
+				case 'b': pos.board[ i ][ j ] = BLACK; break;
+				case '.': pos.board[ i ][ j ] = EMPTY; break;
+				default: return FALSE;
+			}
+			n++;
+		}
+
+	while( *p == ' ' ) p++;
+	if( *p != 'w' && *p != 'b' )
+		return FALSE;
+	pos.turn = ( *p++ == 'w' ) ? WHITE : BLACK;
+
+	if( sscanf( p, "%lf", &result ) != 1 || result < 0 || result > 1 )
+		return FALSE;
+
+	syncPosition( &pos );
+	sampleFromPosition( &pos, result, s );
+
+	return n == HEX_CELLS;
+}
+
+/**********************************************************/
+int unpackSample( unsigned char * record, Sample * s )
+{
+	Position pos;
+
+	if( record[ PACKED_POSITION_BYTES ] > 2 )
+		return FALSE;
+
+	unpackPosition( record, &pos );
+	sampleFromPosition( &pos, record[ PACKED_POSITION_BYTES ] / 2.0, s );
+
+	return TRUE;
+}
+
+/**********************************************************/
+void * loadWorker( void * arg )
+{
+	LoadJob * job = arg;
+	int i;
+
+	for( i = job->first; i < job->last; i++ )
+		if( job->records != NULL )
+			job->ok[ i ] = unpackSample( job->records + ( size_t ) i * PACKED_RECORD_BYTES, &job->out[ i ] );
+		else
+			job->ok[ i ] = parseSample( job->lines[ i ], &job->out[ i ] );
+
+	return NULL;
+}
+
+
+/**********************************************************/
+int loadSamples( char * fileName )
+{
+	FILE * f;
+	char ** lines = NULL;
+	unsigned char * records = NULL;
+	Sample * block;
+	char * ok;
+	int n, i, t, capacity = 0, bad = 0;
+	size_t lineSize = HEX_CELLS + 64;
+	pthread_t tid[ MAX_THREADS ];
+	LoadJob jobs[ MAX_THREADS ];
+
+	if( ( f = fopen( fileName, packedInput ? "rb" : "r" ) ) == NULL )
+	{
+		printf( "ERROR: Cannot open %s\n", fileName );
+		return -1;
+	}
+
+	if( packedInput )
+		records = malloc( ( size_t ) PACKED_RECORD_BYTES * LOAD_BLOCK );
+	else
+	{
+		lines = malloc( sizeof( char * ) * LOAD_BLOCK );
+		for( i = 0; i < LOAD_BLOCK; i++ )
+			lines[ i ] = malloc( lineSize );
+	}
+	block = malloc( sizeof( Sample ) * LOAD_BLOCK );
+	ok = malloc( LOAD_BLOCK );
+
+	while( 1 )
+	{
+		if( packedInput )
+			n = fread( records, PACKED_RECORD_BYTES, LOAD_BLOCK, f );
+		else
+			for( n = 0; n < LOAD_BLOCK && fgets( lines[ n ], lineSize, f ) != NULL; n++ )
+				;
+		if( n == 0 )
+			break;
+
+		for( t = 0; t < threads; t++ )
+		{
+			jobs[ t ].lines = lines;
+			jobs[ t ].records = records;
+			jobs[ t ].out = block;
+			jobs[ t ].ok = ok;
+			jobs[ t ].first = n * t / threads;
+			jobs[ t ].last = n * ( t + 1 ) / threads;
+			pthread_create( &tid[ t ], NULL, loadWorker, &jobs[ t ] );
+		}
+		for( t = 0; t < threads; t++ )
+			pthread_join( tid[ t ], NULL );
+
+		if( sampleCount + n > capacity )
+		{
+			capacity = ( sampleCount + n ) * 2;
+			samples = realloc( samples, sizeof( Sample ) * capacity );
+			if( samples == NULL )
+			{
+				printf( "ERROR: Out of memory after %d positions\n", sampleCount );
+				exit( 1 );
+			}
+		}
+
+		for( i = 0; i < n; i++ )
+			if( ok[ i ] )
+				samples[ sampleCount++ ] = block[ i ];
+			else
+				bad++;
+	}
+
+	if( packedInput )
+		free( records );
+	else
+	{
+		for( i = 0; i < LOAD_BLOCK; i++ )
+			free( lines[ i ] );
+		free( lines );
+	}
+	free( block );
+	free( ok );
+	fclose( f );
+
+	if( bad )
+		printf( "Skipped %d malformed %s\n", bad, packedInput ? "records" : "lines" );
+
+	return 0;
+}
+
+/**********************************************************/
+void * gradientWorker( void * arg )
+{
+	Job * job = arg;
+	Sample * s;
+	double e0, e1, e, p, d;
+	double * w0, * w1;
+	int i, k;
+
+	job->loss = 0;
+	for( k = 0; k < PARAMS; k++ )
+		job->grad[ k ] = 0;
+
+	for( i = job->first; i < job->last; i++ )
+	{
+		s = &samples[ i ];
+
+		/* the same interpolation as evaluate() */
+		if( s->phase == EVAL_PHASES )
+			e = job->params[ ENDGAME_PARAM ] * s->f[ F_PIECES ];
+		else
+		{
+			w0 = job->params + s->phase * EVAL_FEATURES;
+			w1 = job->params + ( s->phase + 1 ) * EVAL_FEATURES;
+			for( e0 = 0, k = 0; k < EVAL_FEATURES; k++ )
+				e0 += w0[ k ] * s->f[ k ];
+			if( s->phase + 1 == EVAL_PHASES )
+				e1 = job->params[ ENDGAME_PARAM ] * s->f[ F_PIECES ];
+			else
+				for( e1 = 0, k = 0; k < EVAL_FEATURES; k++ )
+					e1 += w1[ k ] * s->f[ k ];
+			e = ( 1 - s->t ) * e0 + s->t * e1;
+		}
+
+		p = 1.0 / ( 1.0 + exp( -job->k * e ) );
+		job->loss -= s->result * log( p + 1e-12 ) + ( 1 - s->result ) * log( 1 - p + 1e-12 );
+
+		// d(loss)/d(e) of the logistic loss
+		d = ( p - s->result ) * job->k;
+		if( s->phase == EVAL_PHASES )
+			job->grad[ ENDGAME_PARAM ] += d * s->f[ F_PIECES ];
+		else
+		{
+			for( k = 0; k < EVAL_FEATURES; k++ )
+				job->grad[ s->phase * EVAL_FEATURES + k ] += d * ( 1 - s->t ) * s->f[ k ];
+			if( s->phase + 1 == EVAL_PHASES )
+				job->grad[ ENDGAME_PARAM ] += d * s->t * s->f[ F_PIECES ];
+			else
+				for( k = 0; k < EVAL_FEATURES; k++ )
+					job->grad[ ( s->phase + 1 ) * EVAL_FEATURES + k ] += d * s->t * s->f[ k ];
+		}
+	}
+
+	return NULL;
+}
+
+/**********************************************************/
+double computeGradient( double params[ PARAMS ], double k, double grad[ PARAMS ] )
+{
+	pthread_t tid[ MAX_THREADS ];
+	Job jobs[ MAX_THREADS ];
+	double loss = 0;
+	int t, i;
+
+	for( t = 0; t < threads; t++ )
+	{
+		jobs[ t ].first = ( long ) sampleCount * t / threads;
+		jobs[ t ].last = ( long ) sampleCount * ( t + 1 ) / threads;
+		jobs[ t ].params = params;
+		jobs[ t ].k = k;
+		pthread_create( &tid[ t ], NULL, gradientWorker, &jobs[ t ] );
+	}
+
+	if( grad != NULL )
+		for( i = 0; i < PARAMS; i++ )
+			grad[ i ] = 0;
+
+	for( t = 0; t < threads; t++ )
+	{
+		pthread_join( tid[ t ], NULL );
+		loss += jobs[ t ].loss;
+		if( grad != NULL )
+			for( i = 0; i < PARAMS; i++ )
+				grad[ i ] += jobs[ t ].grad[ i ] / sampleCount;
+	}
+
+	return loss / sampleCount;
+}
+
+/**********************************************************/
+double fitScale( double params[ PARAMS ] )
+{
+	/* golden section search of log(K) */
+	double a = log( 1e-5 ), b = log( 1.0 ), c, d, fc, fd;
+	const double g = 0.6180339887;
+	int i;
+
+	c = b - g * ( b - a );
+	d = a + g * ( b - a );
+	fc = computeGradient( params, exp( c ), NULL );
+	fd = computeGradient( params, exp( d ), NULL );
+
+	for( i = 0; i < 40; i++ )
+	{
+		if( fc < fd )
+		{
+			b = d; d = c; fd = fc;
+			c = b - g * ( b - a );
+			fc = computeGradient( params, exp( c ), NULL );
+		}
+		else
+		{
+			a = c; c = d; fc = fd;
+			d = a + g * ( b - a );
+			fd = computeGradient( params, exp( d ), NULL );
+		}
+	}
+
+	return exp( ( a + b ) / 2 );
+}
+
+/**********************************************************/
+int main( int argc, char ** argv )
+{
+	char * inputFile = NULL;
+	char * outputFile = "weights.txt";
+	int iterations = 1000;
+	double rate = 0.5;		// Adam step, in weight units
+	double params[ PARAMS ], grad[ PARAMS ], m[ PARAMS ] = { 0 }, v[ PARAMS ] = { 0 };
+	double k, loss, mHat, vHat;
+	const double beta1 = 0.9, beta2 = 0.999;
+	EvalWeights tuned;
+	Position pos;
+	time_t start;
+	int c, i, it, phase;
+
+	opterr = 0;
+	while( ( c = getopt( argc, argv, "i:o:t:n:r:w:ph" ) ) != -1 )
+		switch( c )
+		{
+			case 'h':
+				printf( "-i positions_file [-p (packed positions file)] [-o weights_output] [-w starting_weights] [-t threads] [-n iterations] [-r step]\n" );
+				return 0;
+			case 'i':
+				inputFile = optarg;
+				break;
+			case 'p':
+				packedInput = TRUE;
+				break;
+			case 'o':
+				outputFile = optarg;
+				break;
+			case 'w':
+				if( loadEvalWeights( optarg ) < 0 )
+					return 1;
+				break;
+			case 't':
+				threads = atoi( optarg );
+				if( threads < 1 ) threads = 1;
+				if( threads > MAX_THREADS ) threads = MAX_THREADS;
+				break;
+			case 'n':
+				iterations = atoi( optarg );
+				break;
+			case 'r':
+				rate = atof( optarg );
+				break;
+			case '?':
+				if( isprint( optopt ) )
+					printf( "Unknown option or missing argument -%c\n", ( char ) optopt );
+				else
+					printf( "Unknown option character -%c\n", ( char ) optopt );
+				return 1;
+			default:
+				return 1;
+		}
+
+	if( inputFile == NULL )
+	{
+		printf( "ERROR: No positions file (-i)\n" );
+		return 1;
+	}
+
+	initPosition( &pos );		//sets up the tables the loader threads share
+	start = time( NULL );
+	if( loadSamples( inputFile ) < 0 )
+		return 1;
+	if( sampleCount == 0 )
+	{
+		printf( "ERROR: No positions in %s\n", inputFile );
+		return 1;
+	}
+	printf( "Loaded %d positions in %ld s\n", sampleCount, ( long ) ( time( NULL ) - start ) );
+
+	for( phase = 0; phase < EVAL_PHASES; phase++ )
+		for( i = 0; i < EVAL_FEATURES; i++ )
+			params[ phase * EVAL_FEATURES + i ] = evalWeights.w[ phase ][ i ];
+	params[ ENDGAME_PARAM ] = evalWeights.endgame;
+
+	k = fitScale( params );
+	printf( "K = %g, starting loss %.6f\n", k, computeGradient( params, k, NULL ) );
+
+	/* Adam */
+	for( it = 1; it <= iterations; it++ )
+	{
+		loss = computeGradient( params, k, grad );
+
+		for( i = 0; i < PARAMS; i++ )
+		{
+			m[ i ] = beta1 * m[ i ] + ( 1 - beta1 ) * grad[ i ];
+			v[ i ] = beta2 * v[ i ] + ( 1 - beta2 ) * grad[ i ] * grad[ i ];
+			mHat = m[ i ] / ( 1 - pow( beta1, it ) );
+			vHat = v[ i ] / ( 1 - pow( beta2, it ) );
+			params[ i ] -= rate * mHat / ( sqrt( vHat ) + 1e-12 );
+		}
+		if( params[ ENDGAME_PARAM ] < 1 )
+			params[ ENDGAME_PARAM ] = 1;
+
+		if( it % 100 == 0 || it == iterations )
+			printf( "Iteration %d: loss %.6f\n", it, loss );
+	}
+
+	for( phase = 0; phase < EVAL_PHASES; phase++ )
+		for( i = 0; i < EVAL_FEATURES; i++ )
+		{
+			tuned.w[ phase ][ i ] = ( int ) lround( params[ phase * EVAL_FEATURES + i ] );
+			printf( "%s.%d %d\n", featureNames[ i ], phase, tuned.w[ phase ][ i ] );
+		}
+	tuned.endgame = ( int ) lround( params[ ENDGAME_PARAM ] );
+	printf( "endgame %d\n", tuned.endgame );
+
+	if( saveEvalWeights( outputFile, &tuned ) < 0 )
+		return 1;
+	printf( "Weights written to %s (%ld s)\n", outputFile, ( long ) ( time( NULL ) - start ) );
+
+	return 0;
+}